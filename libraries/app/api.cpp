@@ -9,7 +9,21 @@
 
 namespace bts { namespace app {
 
-    database_api::database_api( bts::chain::database& db ):_db(db)
+    api_reader_pool::api_reader_pool( uint32_t thread_count )
+       :_next_thread(0)
+    {
+       FC_ASSERT( thread_count > 0 );
+       for( uint32_t i = 0; i < thread_count; ++i )
+          _threads.push_back( std::make_shared<fc::thread>( "api reader " + fc::to_string(i) ) );
+    }
+
+    fc::thread& api_reader_pool::next_thread()
+    {
+       return *_threads[ _next_thread++ % _threads.size() ];
+    }
+
+    database_api::database_api( bts::chain::database& db, std::shared_ptr<api_reader_pool> readers )
+       :_db(db),_readers(std::move(readers))
     {
        _change_connection = _db.changed_objects.connect( [this]( const vector<object_id_type>& ids ) {
                                     on_objects_changed( ids );
@@ -19,16 +33,19 @@ namespace bts { namespace app {
 
     fc::variants database_api::get_objects( const vector<object_id_type>& ids )const
     {
-       fc::variants result;
-       result.reserve(ids.size());
-       for( auto id : ids )
-       {
-          if( auto obj = _db.find_object(id) )
-             result.push_back( obj->to_variant() );
-          else
-             result.push_back( fc::variant() );
-       }
-       return result;
+       // all objects come from the same snapshot, so they are consistent with each other
+       return read_snapshot( [&]( const bts::db::object_snapshot* snapshot ) -> fc::variants {
+          fc::variants result;
+          result.reserve(ids.size());
+          for( auto id : ids )
+          {
+             if( auto obj = snapshot ? snapshot->find_object(id) : _db.find_object(id) )
+                result.push_back( obj->to_variant() );
+             else
+                result.push_back( fc::variant() );
+          }
+          return result;
+       });
     }
 
     optional<block_header> database_api::get_block_header(uint32_t block_num) const
@@ -73,45 +90,32 @@ namespace bts { namespace app {
     }
     global_property_object    database_api::get_global_properties()const
     {
-       return _db.get( global_property_id_type() );
+       return read_snapshot( [&]( const bts::db::object_snapshot* snapshot ) -> global_property_object {
+          return snapshot ? snapshot->get( global_property_id_type() ) : _db.get( global_property_id_type() );
+       });
     }
 
     dynamic_global_property_object database_api::get_dynamic_global_properties()const
     {
-       return _db.get( dynamic_global_property_id_type() );
+       return read_snapshot( [&]( const bts::db::object_snapshot* snapshot ) -> dynamic_global_property_object {
+          return snapshot ? snapshot->get( dynamic_global_property_id_type() )
+                          : _db.get( dynamic_global_property_id_type() );
+       });
     }
 
     vector<optional<key_object>>      database_api::get_keys( const vector<key_id_type>& key_ids )const
     {
-       vector<optional<key_object>> result; result.reserve(key_ids.size());
-       for( auto id : key_ids )
-       {
-          const key_object* a = _db.find(id);
-          result.push_back( a ? *a : optional<key_object>() );
-       }
-       return result;
+       return find_objects( key_ids );
     }
 
     vector<optional<account_object>>  database_api::get_accounts( const vector<account_id_type>& account_ids )const
     {
-       vector<optional<account_object>> result; result.reserve(account_ids.size());
-       for( auto id : account_ids )
-       {
-          const account_object* a = _db.find(id);
-          result.push_back( a ? *a : optional<account_object>() );
-       }
-       return result;
+       return find_objects( account_ids );
     }
 
     vector<optional<asset_object>>    database_api::get_assets( const vector<asset_id_type>& asset_ids )const
     {
-       vector<optional<asset_object>> result; result.reserve(asset_ids.size());
-       for( auto id : asset_ids )
-       {
-          const asset_object* a = _db.find(id);
-          result.push_back( a ? *a : optional<asset_object>() );
-       }
-       return result;
+       return find_objects( asset_ids );
     }
 
     uint64_t                      database_api::get_account_count()const
@@ -142,22 +146,11 @@ namespace bts { namespace app {
                                                                          int limit,
                                                                          operation_history_id_type start)const
     {
-       FC_ASSERT( limit <= 100 );
-       vector<operation_history_object> result;
-       const auto& stats = a(_db).statistics(_db);
-       if( stats.most_recent_op == account_transaction_history_id_type() ) return result;
-       const account_transaction_history_object* node = &stats.most_recent_op(_db);
-       if( start == operation_history_id_type() )
-          start = node->id;
-       while( node && node->operation_id.instance.value > stop.instance.value && result.size() < limit )
-       {
-          if( node->id.instance() <= start.instance.value )
-             result.push_back( node->operation_id(_db) );
-          if( node->next == account_transaction_history_id_type() )
-             node = nullptr;
-          else node = _db.find(node->next);
-       }
-       return result;
+       FC_ASSERT( limit >= 0 && limit <= 100 );
+       const account_history_store* history = _db.get_account_history_store();
+       if( history == nullptr )
+          return vector<operation_history_object>();
+       return history->get_account_history( a, stop.instance.value, limit, start.instance.value );
     }
 
     vector<asset>  database_api::get_account_balances( account_id_type acnt, const flat_set<asset_id_type>& assets )const
@@ -241,6 +234,23 @@ namespace bts { namespace app {
                                               settle_index.upper_bound(mia.get_id()));
     }
 
+    vector<price_level> database_api::get_market_depth( asset_id_type a, asset_id_type b, uint32_t limit )const
+    {
+       const market_depth* depth = _db.get_market_depth();
+       FC_ASSERT( depth, "Market depth is not maintained by this node" );
+       FC_ASSERT( a != b );
+
+       vector<price_level> result;
+       for( auto type : { limit_depth, short_depth, call_depth } )
+       {
+          auto levels = depth->get_levels( type, a, b, limit );
+          result.insert( result.end(), levels.begin(), levels.end() );
+          levels = depth->get_levels( type, b, a, limit );
+          result.insert( result.end(), levels.begin(), levels.end() );
+       }
+       return result;
+    }
+
     vector<asset_object> database_api::list_assets( const string& lower_bound_symbol, uint32_t limit )const
     {
        /*
@@ -370,10 +380,13 @@ namespace bts { namespace app {
           if( _subscriptions.find(id) != _subscriptions.end() )
              my_objects.push_back(id);
 
+       // The snapshot of the block which changed them is only published once push_block is done with it, and by then
+       // the database may hold pending transactions again; the notifications go out afterwards and read that snapshot.
        _broadcast_changes_complete = fc::async( [=](){
+          auto snapshot = _db.get_snapshot();
           for( auto id : my_objects )
           {
-             const object* obj = _db.find_object(id);
+             const object* obj = snapshot ? snapshot->find_object(id) : _db.find_object(id);
              if( obj )
              {
                 _subscriptions[id]( obj->to_variant() );
@@ -387,6 +400,28 @@ namespace bts { namespace app {
      */
     void database_api::on_applied_block()
     {
+       const market_depth* depth = _db.get_market_depth();
+       if( depth && _market_depth_subscriptions.size() )
+       {
+          map< std::pair<asset_id_type,asset_id_type>, vector<price_level> > changed_depth;
+          for( const auto& level : depth->get_changed_levels() )
+          {
+             auto market = std::make_pair( level.sell_price.base.asset_id, level.sell_price.quote.asset_id );
+             if( market.first > market.second ) std::swap( market.first, market.second );
+             if( _market_depth_subscriptions.find( market ) != _market_depth_subscriptions.end() )
+                changed_depth[market].push_back( level );
+          }
+          if( changed_depth.size() )
+             fc::async( [=](){
+                for( const auto& item : changed_depth )
+                {
+                   auto itr = _market_depth_subscriptions.find( item.first );
+                   if( itr != _market_depth_subscriptions.end() )
+                      itr->second( fc::variant(item.second) );
+                }
+             });
+       }
+
        if( _market_subscriptions.size() == 0 ) 
           return;
 
@@ -474,6 +509,23 @@ namespace bts { namespace app {
        return true;
     }
 
+    bool  database_api::subscribe_to_market_depth( std::function<void(const variant&)> callback, asset_id_type a, asset_id_type b )
+    {
+       FC_ASSERT( _db.get_market_depth(), "Market depth is not maintained by this node" );
+       if( a > b ) std::swap(a,b);
+       FC_ASSERT( a != b );
+       _market_depth_subscriptions[ std::make_pair(a,b) ] = callback;
+       return true;
+    }
+
+    bool  database_api::unsubscribe_from_market_depth( asset_id_type a, asset_id_type b )
+    {
+       if( a > b ) std::swap(a,b);
+       FC_ASSERT( a != b );
+       _market_depth_subscriptions.erase( std::make_pair(a,b) );
+       return true;
+    }
+
     std::string  database_api::get_transaction_hex( const signed_transaction& trx )const
     {
        return fc::to_hex( fc::raw::pack(trx) );
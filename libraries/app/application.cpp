@@ -2,7 +2,10 @@
 #include <bts/app/plugin.hpp>
 #include <bts/app/api.hpp>
 
+#include <bts/chain/exceptions.hpp>
+
 #include <bts/net/core_messages.hpp>
+#include <bts/net/exceptions.hpp>
 
 #include <bts/time/time.hpp>
 
@@ -14,6 +17,7 @@
 #include <boost/filesystem/path.hpp>
 
 #include <iostream>
+#include <thread>
 
 #include <fc/log/file_appender.hpp>
 #include <fc/log/logger.hpp>
@@ -83,7 +87,7 @@ namespace detail {
          _websocket_server->on_connection([&]( const fc::http::websocket_connection_ptr& c ){
             auto wsc = std::make_shared<fc::rpc::websocket_api_connection>(*c);
             auto login = std::make_shared<bts::app::login_api>( std::ref(*_self) );
-            auto db_api = std::make_shared<bts::app::database_api>( std::ref(*_self->chain_database()) );
+            auto db_api = std::make_shared<bts::app::database_api>( std::ref(*_self->chain_database()), _api_readers );
             wsc->register_api(fc::api<bts::app::database_api>(db_api));
             wsc->register_api(fc::api<bts::app::login_api>(login));
             c->set_session_data( wsc );
@@ -106,7 +110,7 @@ namespace detail {
          _websocket_tls_server->on_connection([&]( const fc::http::websocket_connection_ptr& c ){
             auto wsc = std::make_shared<fc::rpc::websocket_api_connection>(*c);
             auto login = std::make_shared<bts::app::login_api>( std::ref(*_self) );
-            auto db_api = std::make_shared<bts::app::database_api>( std::ref(*_self->chain_database()) );
+            auto db_api = std::make_shared<bts::app::database_api>( std::ref(*_self->chain_database()), _api_readers );
             wsc->register_api(fc::api<bts::app::database_api>(db_api));
             wsc->register_api(fc::api<bts::app::login_api>(login));
             c->set_session_data( wsc );
@@ -141,6 +145,9 @@ namespace detail {
          if( _options->count("resync-blockchain") )
             _chain_db->wipe(_data_dir / "blockchain", true);
 
+         if( _options->count("checkpoint-interval") )
+            _chain_db->set_checkpoint_interval( _options->at("checkpoint-interval").as<uint32_t>() );
+
          if( _options->count("replay-blockchain") )
          {
             ilog("Replaying blockchain on user request.");
@@ -148,8 +155,18 @@ namespace detail {
          } else if( clean )
             _chain_db->open(_data_dir / "blockchain", initial_allocation);
          else {
-            wlog("Detected unclean shutdown. Replaying blockchain...");
-            _chain_db->reindex(_data_dir / "blockchain", initial_allocation);
+            // open() restores the last checkpoint and replays the blocks stored after it
+            wlog("Detected unclean shutdown. Restoring last checkpoint...");
+            _chain_db->open(_data_dir / "blockchain", initial_allocation);
+         }
+
+         // API calls read objects from per-block snapshots rather than the live, possibly mid-block, state, on threads
+         // of their own so that they do not hold up the chain thread
+         if( _options->count("rpc-endpoint") || _options->count("rpc-tls-endpoint") )
+         {
+            _chain_db->enable_snapshots( _chain_db->head_block_num() );
+            _chain_db->enable_market_depth();
+            _api_readers = std::make_shared<api_reader_pool>( std::max( 1u, std::thread::hardware_concurrency() / 2 ) );
          }
 
          reset_p2p_node(_data_dir);
@@ -185,6 +202,12 @@ namespace detail {
          ilog("Got block #${n} from network", ("n", blk_msg.block.block_num()));
          try {
             return _chain_db->push_block( blk_msg.block, _is_block_producer? database::skip_nothing : database::skip_transaction_signatures );
+         } catch( const chain::unlinkable_block& e ) {
+            // The fork database holds the block until its previous block arrives, so it was not rejected, but neither
+            // has it been validated: the node must neither penalize the peer nor relay the block.
+            wlog("Holding block #${n} until its previous block arrives: ${e}", ("n", blk_msg.block.block_num())("e", e.to_string()));
+            FC_THROW_EXCEPTION( net::unlinkable_block, "block ${id} is held until its previous block ${prev} arrives",
+                                ("id", blk_msg.block_id)("prev", blk_msg.block.previous) );
          } catch( const fc::exception& e ) {
             elog("Error when pushing block:\n${e}", ("e", e.to_detail_string()));
             throw;
@@ -368,6 +391,7 @@ namespace detail {
       std::shared_ptr<bts::net::node>                  _p2p_network;
       std::shared_ptr<fc::http::websocket_server>      _websocket_server;
       std::shared_ptr<fc::http::websocket_tls_server>  _websocket_tls_server;
+      std::shared_ptr<api_reader_pool>                 _api_readers;
 
       std::map<string, std::shared_ptr<abstract_plugin>> _plugins;
    };
@@ -404,6 +428,7 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("server-pem,p", bpo::value<string>()->implicit_value("server.pem"), "The TLS certificate file for this server")
          ("server-pem-password,P", bpo::value<string>()->implicit_value(""), "Password for this certificate")
          ("genesis-json", bpo::value<boost::filesystem::path>(), "File to read Genesis State from")
+         ("checkpoint-interval", bpo::value<uint32_t>(), "Number of blocks between crash recovery checkpoints of the chain state (0 to disable)")
          ;
    command_line_options.add(configuration_file_options);
    command_line_options.add_options()
@@ -440,6 +465,11 @@ std::shared_ptr<chain::database> application::chain_database() const
    return my->_chain_db;
 }
 
+fc::path application::data_dir()const
+{
+   return my->_data_dir;
+}
+
 void application::set_block_production(bool producing_blocks)
 {
    my->_is_block_producer = producing_blocks;
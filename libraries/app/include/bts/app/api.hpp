@@ -9,16 +9,46 @@
 #include <bts/chain/key_object.hpp>
 #include <bts/net/node.hpp>
 #include <fc/api.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <atomic>
 
 namespace bts { namespace app {
    using namespace bts::chain;
 
    class application;
 
+   /**
+    * @class api_reader_pool
+    * @brief threads on which API calls read database snapshots, so that API load does not hold up the chain thread
+    */
+   class api_reader_pool
+   {
+      public:
+         api_reader_pool( uint32_t thread_count );
+
+         /**
+          * Runs read on one of the threads and returns its result.  The calling task waits for it, letting other tasks
+          * on the calling thread, such as pushing blocks, run meanwhile.
+          */
+         template<typename Functor>
+         auto run( Functor&& read ) -> decltype( read() )
+         {
+            return next_thread().async( std::forward<Functor>(read), "api read" ).wait();
+         }
+
+      private:
+         fc::thread& next_thread();
+
+         vector<std::shared_ptr<fc::thread>> _threads;
+         std::atomic<uint32_t>               _next_thread;
+   };
+
    class database_api
    {
       public:
-         database_api( bts::chain::database& db );
+         /// @param readers if given, calls which read snapshots do so on these threads
+         database_api( bts::chain::database& db, std::shared_ptr<api_reader_pool> readers = nullptr );
          ~database_api();
          fc::variants                      get_objects( const vector<object_id_type>& ids )const;
          optional<block_header>            get_block_header(uint32_t block_num)const;
@@ -47,6 +77,12 @@ namespace bts { namespace app {
          vector<short_order_object>        get_short_orders( asset_id_type a, uint32_t limit )const;
          vector<call_order_object>         get_call_orders( asset_id_type a, uint32_t limit )const;
          vector<force_settlement_object>   get_settle_orders( asset_id_type a, uint32_t limit )const;
+         /**
+          *  @return up to limit price levels of each kind of order (limit, short and call) on each side of the market
+          *  for the two assets specified, best first.  The cost is proportional to the number of levels returned, not
+          *  the number of orders.
+          */
+         vector<price_level>               get_market_depth( asset_id_type a, asset_id_type b, uint32_t limit )const;
 
          vector<asset_object>              list_assets( const string& lower_bound_symbol, uint32_t limit )const;
 
@@ -57,11 +93,49 @@ namespace bts { namespace app {
          bool                              subscribe_to_market( std::function<void(const variant&)> callback, 
                                                                 asset_id_type, asset_id_type );
          bool                              unsubscribe_from_market( asset_id_type, asset_id_type );
+         /**
+          *  After each block, callback is passed the current state of every price level of the market which the block
+          *  changed, as a vector<price_level>.  Emptied levels are reported with an order_count of 0.
+          */
+         bool                              subscribe_to_market_depth( std::function<void(const variant&)> callback,
+                                                                      asset_id_type, asset_id_type );
+         bool                              unsubscribe_from_market_depth( asset_id_type, asset_id_type );
          void                              cancel_all_subscriptions()
-         { _subscriptions.clear(); _market_subscriptions.clear(); }
+         { _subscriptions.clear(); _market_subscriptions.clear(); _market_depth_subscriptions.clear(); }
 
          std::string                       get_transaction_hex( const signed_transaction& trx )const;
       private:
+         /**
+          * Look up objects in the latest snapshot (so that, unlike the live database, it is safe to do from any
+          * thread), or in the live database if snapshots are not enabled
+          */
+         template<uint8_t SpaceID, uint8_t TypeID, typename T>
+         vector<optional<T>> find_objects( const vector<object_id<SpaceID,TypeID,T>>& ids )const
+         {
+            return read_snapshot( [&]( const bts::db::object_snapshot* snapshot ) -> vector<optional<T>> {
+               vector<optional<T>> result; result.reserve(ids.size());
+               for( auto id : ids )
+               {
+                  const T* obj = snapshot ? snapshot->find(id) : _db.find(id);
+                  result.push_back( obj ? *obj : optional<T>() );
+               }
+               return result;
+            });
+         }
+
+         /**
+          * Passes read the latest snapshot, on one of the reader threads if there are any, or null (on the calling
+          * thread) if snapshots are not enabled
+          */
+         template<typename Functor>
+         auto read_snapshot( Functor&& read )const -> decltype( read( (const bts::db::object_snapshot*)nullptr ) )
+         {
+            auto snapshot = _db.get_snapshot();
+            if( snapshot && _readers )
+               return _readers->run( [&]() { return read( snapshot.get() ); } );
+            return read( snapshot.get() );
+         }
+
          /** called every time a block is applied to report the objects that were changed */
          void on_objects_changed( const vector<object_id_type>& ids );
          void on_applied_block();
@@ -71,7 +145,9 @@ namespace bts { namespace app {
          boost::signals2::scoped_connection                                                                        _applied_block_connection;
          map<object_id_type, std::function<void(const fc::variant&)> >                                             _subscriptions;
          map< pair<asset_id_type,asset_id_type>, std::function<void(const variant& )> >                            _market_subscriptions;
+         map< pair<asset_id_type,asset_id_type>, std::function<void(const variant& )> >                            _market_depth_subscriptions;
          bts::chain::database&                                                                                     _db;
+         std::shared_ptr<api_reader_pool>                                                                          _readers;
    };
 
    class history_api
@@ -138,11 +214,14 @@ FC_API( bts::app::database_api,
         (get_short_orders)
         (get_call_orders)
         (get_settle_orders)
+        (get_market_depth)
         (list_assets)
         (subscribe_to_objects)
         (unsubscribe_from_objects)
         (subscribe_to_market)
         (unsubscribe_from_market)
+        (subscribe_to_market_depth)
+        (unsubscribe_from_market_depth)
         (cancel_all_subscriptions)
         (get_transaction_hex)
       )
@@ -56,6 +56,8 @@ namespace bts { namespace app {
 
          net::node_ptr                    p2p_node();
          std::shared_ptr<chain::database> chain_database()const;
+         /** @return the directory passed to initialize(), or an empty path if the application was not initialized */
+         fc::path                         data_dir()const;
 
          void set_block_production(bool producing_blocks);
 
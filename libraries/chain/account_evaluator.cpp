@@ -161,9 +161,15 @@ object_id_type account_update_evaluator::do_evaluate( const account_update_opera
 }
 object_id_type account_update_evaluator::do_apply( const account_update_operation& o )
 {
+   const auto& dynamic_props = db().get_dynamic_global_properties();
+   if( o.owner || o.active )
+      db().modify( dynamic_props, []( dynamic_global_property_object& dgp ) {
+         ++dgp.authority_revision;
+      });
    db().modify( *acnt, [&]( account_object& a  ){
           if( o.owner ) a.owner = *o.owner;
           if( o.active ) a.active = *o.active;
+          if( o.owner || o.active ) a.authority_revision = dynamic_props.authority_revision;
           if( o.voting_account ) a.voting_account = *o.voting_account;
           if( o.memo_key ) a.memo_key = *o.memo_key;
           if( o.vote ) a.votes = *o.vote;
@@ -0,0 +1,172 @@
+#include <bts/chain/account_history_store.hpp>
+#include <bts/chain/config.hpp>
+
+#include <limits>
+
+namespace bts { namespace chain {
+
+void account_history_store::open( const fc::path& dbdir, size_t cache_size )
+{ try {
+   fc::create_directories( dbdir );
+   _dbdir = dbdir;
+   _cache_size = cache_size;
+   _history.open( dbdir / "history", true, cache_size );
+   _history_size.open( dbdir / "history_size" );
+   _journal.open( dbdir / "journal" );
+} FC_CAPTURE_AND_RETHROW( (dbdir)(cache_size) ) }
+
+bool account_history_store::is_open()const
+{
+   return _history.is_open();
+}
+
+void account_history_store::close()
+{
+   _history.close();
+   _history_size.close();
+   _journal.close();
+}
+
+void account_history_store::wipe()
+{ try {
+   FC_ASSERT( is_open() );
+   close();
+   fc::remove_all( _dbdir );
+   open( _dbdir, _cache_size );
+} FC_CAPTURE_AND_RETHROW( (_dbdir) ) }
+
+uint64_t account_history_store::get_next_sequence()const
+{
+   auto itr = _journal.last();
+   if( itr.valid() )
+      return itr.value().next_sequence;
+   return 1;
+}
+
+void account_history_store::store_block( uint32_t block_num, vector<applied_operation>& ops )
+{ try {
+   FC_ASSERT( is_open() );
+   truncate( block_num );
+
+   block_journal_entry entry;
+   entry.next_sequence = get_next_sequence();
+   for( auto& o : ops )
+   {
+      o.op.id = operation_history_id_type( entry.next_sequence++ );
+      for( auto account : o.accounts )
+         entry.keys.emplace_back( account, o.op.id.instance() );
+   }
+   // Journal the block before writing its history so that anything left behind by a crash part way through is
+   // discarded when the block is replayed.
+   _journal.store( block_num, entry );
+
+   for( const auto& o : ops )
+   {
+      for( auto account : o.accounts )
+      {
+         _history.store( history_key( account, o.op.id.instance() ), o.op );
+         auto size = _history_size.fetch_optional( account );
+         _history_size.store( account, (size ? *size : 0) + 1 );
+         if( _max_ops_per_account > 0 )
+            prune_account( account );
+      }
+   }
+
+   // History younger than the undo history may still be unwound, so it is journaled (and kept) at least that long.
+   uint32_t journal_depth = std::max<uint32_t>( BTS_DEFAULT_MAX_UNDO_HISTORY, _max_age );
+   if( block_num <= journal_depth )
+      return;
+   for( auto itr = _journal.begin(); itr.valid() && itr.key() <= block_num - journal_depth; )
+   {
+      uint32_t expired_num = itr.key();
+      if( _max_age > 0 )
+         for( const auto& k : itr.value().keys )
+            remove_key( k );
+      ++itr;
+      _journal.remove( expired_num );
+   }
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
+void account_history_store::truncate( uint32_t block_num )
+{
+   auto last = _journal.last();
+   if( !last.valid() || last.key() < block_num )
+      return;
+
+   if( _journal.begin().key() > block_num )
+   {
+      // The history being replaced predates the journal, so we can no longer tell which keys it wrote.
+      wlog( "Account history for block ${n} is no longer journaled; discarding all account history", ("n", block_num) );
+      wipe();
+      return;
+   }
+
+   while( last.valid() && last.key() >= block_num )
+   {
+      uint32_t popped_num = last.key();
+      auto keys = last.value().keys;
+      for( auto itr = keys.rbegin(); itr != keys.rend(); ++itr )
+         remove_key( *itr );
+      _journal.remove( popped_num );
+      last = _journal.last();
+   }
+}
+
+void account_history_store::remove_key( const history_key& k )
+{
+   if( !_history.find( k ).valid() )
+      return;
+   _history.remove( k );
+
+   auto size = _history_size.fetch_optional( k.account );
+   if( size && *size > 1 )
+      _history_size.store( k.account, *size - 1 );
+   else
+      _history_size.remove( k.account );
+}
+
+void account_history_store::prune_account( account_id_type a )
+{
+   auto size = get_account_history_size( a );
+   while( size > _max_ops_per_account )
+   {
+      auto oldest = _history.lower_bound( history_key( a, 0 ) );
+      if( !oldest.valid() || oldest.key().account != a )
+         break;
+      remove_key( oldest.key() );
+      --size;
+   }
+}
+
+vector<operation_history_object> account_history_store::get_account_history( account_id_type a, uint64_t stop,
+                                                                               uint32_t limit, uint64_t start )const
+{ try {
+   FC_ASSERT( is_open() );
+   vector<operation_history_object> result;
+   history_key first( a, start == 0 ? std::numeric_limits<uint64_t>::max() : start );
+
+   // seek to the most recent entry at or before first
+   auto itr = _history.lower_bound( first );
+   if( !itr.valid() )
+      itr = _history.last();
+   else if( !(itr.key() == first) )
+      --itr;
+
+   while( itr.valid() && result.size() < limit )
+   {
+      auto key = itr.key();
+      if( key.account != a || key.sequence <= stop )
+         break;
+      result.push_back( itr.value() );
+      --itr;
+   }
+   return result;
+} FC_CAPTURE_AND_RETHROW( (a)(stop)(limit)(start) ) }
+
+uint64_t account_history_store::get_account_history_size( account_id_type a )const
+{
+   auto size = _history_size.fetch_optional( a );
+   return size ? *size : 0;
+}
+
+} }
@@ -1,6 +1,9 @@
 #include <bts/chain/asset.hpp>
 #include <fc/uint128.hpp>
 
+#include <cstring>
+#include <limits>
+
 namespace bts { namespace chain {
       bool operator < ( const asset& a, const asset& b )
       {
@@ -18,7 +21,7 @@ namespace bts { namespace chain {
          if( a.quote.asset_id > b.quote.asset_id ) return false;
          auto amult = fc::uint128(b.quote.amount.value) * a.base.amount.value;
          auto bmult = fc::uint128(a.quote.amount.value) * b.base.amount.value;
-         assert( (a.to_real() < b.to_real()) == (amult < bmult) );
+         assert( !(amult < bmult) || a.to_real() <= b.to_real() ); // ratios this close may round to equal doubles
          return amult < bmult;
       }
       bool operator <= ( const price& a, const price& b )
@@ -29,7 +32,7 @@ namespace bts { namespace chain {
          if( a.quote.asset_id > b.quote.asset_id ) return false;
          auto amult = fc::uint128(b.quote.amount.value) * a.base.amount.value;
          auto bmult = fc::uint128(a.quote.amount.value) * b.base.amount.value;
-         assert( (a.to_real() <= b.to_real()) == (amult <= bmult) );
+         assert( !(amult <= bmult) || a.to_real() <= b.to_real() );
          return amult <= bmult;
       }
       bool operator == ( const price& a, const price& b )
@@ -56,6 +59,18 @@ namespace bts { namespace chain {
          return !(a <= b);
       }
 
+      bool operator < ( const sortable_price& a, const sortable_price& b )
+      {
+         const price& ap = *a.value;
+         const price& bp = *b.value;
+         if( ap.base.asset_id < bp.base.asset_id ) return true;
+         if( ap.base.asset_id > bp.base.asset_id ) return false;
+         if( ap.quote.asset_id < bp.quote.asset_id ) return true;
+         if( ap.quote.asset_id > bp.quote.asset_id ) return false;
+         if( a.key != b.key ) return a.key < b.key;
+         return ap < bp;
+      }
+
       asset operator * ( const asset& a, const price& b )
       {
          if( a.asset_id == b.base.asset_id )
@@ -83,6 +98,19 @@ namespace bts { namespace chain {
       price price::max( asset_id_type base, asset_id_type quote ) { return asset( share_type(BTS_MAX_SHARE_SUPPLY), base ) / asset( share_type(1), quote); }
       price price::min( asset_id_type base, asset_id_type quote ) { return asset( 1, base ) / asset( BTS_MAX_SHARE_SUPPLY, quote); }
 
+      uint64_t price::sort_key()const
+      {
+         // Order book prices are positive, and the bits of a positive double compare as unsigned integers in the same
+         // order as the doubles themselves.  Amounts are below 2^53, so each converts exactly.
+         if( quote.amount.value <= 0 || base.amount.value <= 0 )
+            return quote.amount.value <= 0 && base.amount.value > 0 ? std::numeric_limits<uint64_t>::max() : 0;
+         double ratio = to_real();
+         uint64_t key;
+         static_assert( sizeof(key) == sizeof(ratio), "sort keys are the bits of a double" );
+         memcpy( &key, &ratio, sizeof(key) );
+         return key;
+      }
+
       price price::call_price(const asset& debt, const asset& collateral, uint16_t collateral_ratio)
       {
          fc::uint128 tmp( collateral.amount.value );
@@ -0,0 +1,36 @@
+#include <bts/chain/authority_cache.hpp>
+
+namespace bts { namespace chain {
+
+bool authority_cache::is_approved( account_id_type account, authority::classification auth_class,
+                                   const vector<key_id_type>& signing_keys )const
+{
+   auto itr = _approvals.find( std::make_pair( account, auth_class ) );
+   return itr != _approvals.end() && itr->second.find( signing_keys ) != itr->second.end();
+}
+
+void authority_cache::add_approval( account_id_type account, authority::classification auth_class,
+                                    const vector<key_id_type>& signing_keys, const vector<account_id_type>& accounts_read )
+{
+   if( _approvals[std::make_pair( account, auth_class )].insert( signing_keys ).second )
+      ++_approval_count;
+   for( const auto& id : accounts_read )
+      _accounts_read.insert( id );
+}
+
+void authority_cache::clear()
+{
+   _approvals.clear();
+   _approval_count = 0;
+   _accounts_read.clear();
+}
+
+void authority_cache::on_change( object_id_type account )
+{
+   // Changes are rare next to checks, and one account may be read by many approvals, so rather than track which
+   // approvals read it, all are dropped.
+   if( _accounts_read.find( account ) != _accounts_read.end() )
+      clear();
+}
+
+} } // bts::chain
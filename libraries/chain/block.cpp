@@ -35,18 +35,27 @@ namespace bts { namespace chain {
 
    checksum_type signed_block::calculate_merkle_root()const
    {
-      if( transactions.size() == 0 ) return checksum_type();
-
-      vector<digest_type>  ids;
-      ids.resize( ((transactions.size() + 1)/2)*2 );
-      for( uint32_t i = 0; i < transactions.size(); ++i )
-         ids[i] = transactions[i].merkle_digest();
+      vector<digest_type> leaf_digests;
+      leaf_digests.reserve( transactions.size() );
+      for( const auto& trx : transactions )
+         leaf_digests.push_back( trx.merkle_digest() );
+      return calculate_merkle_root( std::move(leaf_digests) );
+   }
 
-      while( ids.size() > 1 )
+   checksum_type signed_block::calculate_merkle_root( vector<digest_type> ids )
+   {
+      if( ids.size() == 0 ) return checksum_type();
+
+      // Every level pairs up as many digests as there are leaves, reading past the digests the level produced, so the
+      // buffer keeps its full size and only the number of digests in use shrinks.  Existing roots depend on this.
+      const size_t leaf_count = ids.size();
+      ids.resize( ((leaf_count + 1)/2)*2 );
+      size_t in_use = ids.size();
+      while( in_use > 1 )
       {
-         for( uint32_t i = 0; i < transactions.size(); i += 2 )
+         for( size_t i = 0; i < leaf_count; i += 2 )
             ids[i/2] = digest_type::hash( std::make_pair( ids[i], ids[i+1] ) );
-         ids.resize( ids.size() / 2 );
+         in_use /= 2;
       }
       return checksum_type::hash( ids[0] );
    }
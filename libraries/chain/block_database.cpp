@@ -0,0 +1,247 @@
+#include <bts/chain/block_database.hpp>
+#include <fc/io/raw.hpp>
+
+#include <boost/filesystem.hpp>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace bts { namespace chain {
+
+namespace {
+
+/// Forces what has been written to the file at path onto the disk
+void sync_file( const fc::path& path )
+{
+#ifndef WIN32
+   int fd = ::open( path.string().c_str(), O_RDONLY );
+   FC_ASSERT( fd >= 0, "Unable to open file to sync it", ("path", path) );
+   int result = ::fsync( fd );
+   ::close( fd );
+#else
+   int fd = _open( path.string().c_str(), _O_RDWR | _O_BINARY );
+   FC_ASSERT( fd >= 0, "Unable to open file to sync it", ("path", path) );
+   int result = _commit( fd );
+   _close( fd );
+#endif
+   FC_ASSERT( result == 0, "Unable to sync file", ("path", path) );
+}
+
+}
+
+void block_database::open( const fc::path& dbdir )
+{ try {
+   fc::create_directories( dbdir );
+   _dbdir = dbdir;
+   auto mode = std::fstream::binary | std::fstream::in | std::fstream::out;
+   if( !fc::exists( dbdir / "index" ) || !fc::exists( dbdir / "blocks" ) )
+      mode |= std::fstream::trunc;
+   else
+      drop_torn_entries( dbdir );
+   _block_num_to_pos.open( (dbdir / "index").string().c_str(), mode );
+   _blocks.open( (dbdir / "blocks").string().c_str(), mode );
+   FC_ASSERT( _block_num_to_pos.is_open() && _blocks.is_open(), "Unable to open block database" );
+} FC_CAPTURE_AND_RETHROW( (dbdir) ) }
+
+/**
+ * A crash can leave index entries on the disk for blocks which never made it into the data file, or only partly did.
+ * Blocks stored later would be appended where those entries point, and would be read back as the lost blocks, so the
+ * index is cut back to the last entry whose block is fully present.  Any torn data is left where it is; new blocks
+ * are appended after it.
+ */
+void block_database::drop_torn_entries( const fc::path& dbdir )
+{ try {
+   const auto index_path = (dbdir / "index").string();
+   const auto blocks_path = (dbdir / "blocks").string();
+   const int64_t index_size = boost::filesystem::file_size( index_path );
+   const int64_t blocks_size = boost::filesystem::file_size( blocks_path );
+
+   int64_t kept_entries = index_size / sizeof(index_entry);
+   {
+      std::ifstream index( index_path.c_str(), std::ifstream::binary );
+      std::ifstream blocks( blocks_path.c_str(), std::ifstream::binary );
+      for( ; kept_entries > 0; --kept_entries )
+      {
+         index_entry e;
+         index.seekg( (kept_entries - 1) * sizeof(e) );
+         index.read( (char*)&e, sizeof(e) );
+         if( e.block_size == 0 )
+            continue;
+         if( int64_t(e.block_pos + e.block_size) <= blocks_size )
+         {
+            vector<char> data( e.block_size );
+            blocks.seekg( e.block_pos );
+            blocks.read( data.data(), data.size() );
+            try {
+               if( fc::raw::unpack<signed_block_header>( data ).id() == e.block_id )
+                  break;
+            } catch( ... ) {}
+         }
+         wlog( "Dropping block ${n} from the block log, as it was not completely written", ("n", kept_entries) );
+      }
+   }
+
+   if( kept_entries * int64_t(sizeof(index_entry)) < index_size )
+      boost::filesystem::resize_file( index_path, kept_entries * sizeof(index_entry) );
+} FC_CAPTURE_AND_RETHROW( (dbdir) ) }
+
+bool block_database::is_open()const
+{
+   return _blocks.is_open();
+}
+
+void block_database::close()
+{
+   _blocks.close();
+   _block_num_to_pos.close();
+}
+
+void block_database::flush()
+{ try {
+   _blocks.flush();
+   _block_num_to_pos.flush();
+   FC_ASSERT( _blocks.good() && _block_num_to_pos.good(), "Unable to write block database" );
+   // the blocks go first, so that a durable index entry never points past the end of the durable data
+   sync_file( _dbdir / "blocks" );
+   sync_file( _dbdir / "index" );
+} FC_CAPTURE_AND_RETHROW() }
+
+void block_database::store( const block_id_type& id, const signed_block& b )
+{
+   auto num = block_header::num_from_id( id );
+   FC_ASSERT( num > 0 );
+
+   auto vec = fc::raw::pack( b );
+   _blocks.clear();
+   _blocks.seekp( 0, _blocks.end );
+
+   index_entry e;
+   e.block_pos  = _blocks.tellp();
+   e.block_size = vec.size();
+   e.block_id   = id;
+   _blocks.write( vec.data(), vec.size() );
+
+   _block_num_to_pos.clear();
+   _block_num_to_pos.seekp( sizeof(e) * int64_t(num - 1) );
+   _block_num_to_pos.write( (const char*)&e, sizeof(e) );
+
+   // Any entries above num are for blocks which are no longer on the chain; they must not survive to point into data
+   // appended after them.
+   _block_num_to_pos.seekp( 0, _block_num_to_pos.end );
+   int64_t index_end = _block_num_to_pos.tellp();
+   if( index_end > int64_t(sizeof(e) * num) )
+   {
+      index_entry empty;
+      _block_num_to_pos.seekp( sizeof(e) * int64_t(num) );
+      for( int64_t pos = sizeof(e) * int64_t(num); pos < index_end; pos += sizeof(e) )
+         _block_num_to_pos.write( (const char*)&empty, sizeof(empty) );
+   }
+}
+
+void block_database::remove( const block_id_type& id )
+{
+   auto num = block_header::num_from_id( id );
+   auto e = read_index_entry( num );
+   if( !e || e->block_id != id )
+      return;
+
+   // The block data is left in the log; the chain only ever pops recent blocks, so the waste is bounded by the
+   // number of blocks replaced during fork switches.
+   index_entry empty;
+   _block_num_to_pos.clear();
+   _block_num_to_pos.seekp( sizeof(empty) * int64_t(num - 1) );
+   _block_num_to_pos.write( (const char*)&empty, sizeof(empty) );
+}
+
+bool block_database::contains( const block_id_type& id )const
+{
+   auto e = read_index_entry( block_header::num_from_id( id ) );
+   return e.valid() && e->block_id == id;
+}
+
+block_id_type block_database::fetch_block_id( uint32_t block_num )const
+{
+   auto e = read_index_entry( block_num );
+   FC_ASSERT( e.valid(), "Unable to find block", ("block_num", block_num) );
+   return e->block_id;
+}
+
+optional<signed_block> block_database::fetch_optional( const block_id_type& id )const
+{ try {
+   auto e = read_index_entry( block_header::num_from_id( id ) );
+   if( !e || e->block_id != id )
+      return optional<signed_block>();
+   return read_block( *e );
+} FC_CAPTURE_AND_RETHROW( (id) ) }
+
+optional<signed_block> block_database::fetch_by_number( uint32_t block_num )const
+{ try {
+   auto e = read_index_entry( block_num );
+   if( !e )
+      return optional<signed_block>();
+   return read_block( *e );
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
+optional<signed_block> block_database::last()const
+{ try {
+   _block_num_to_pos.clear();
+   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
+   int64_t pos = _block_num_to_pos.tellg();
+
+   // Popped blocks leave empty entries at the end of the index
+   index_entry e;
+   while( pos >= int64_t(sizeof(e)) )
+   {
+      pos -= sizeof(e);
+      _block_num_to_pos.seekg( pos );
+      _block_num_to_pos.read( (char*)&e, sizeof(e) );
+      if( _block_num_to_pos.gcount() == sizeof(e) && e.block_size > 0 )
+         return read_block( e );
+   }
+   return optional<signed_block>();
+} FC_CAPTURE_AND_RETHROW() }
+
+optional<block_database::index_entry> block_database::read_index_entry( uint32_t block_num )const
+{
+   if( block_num == 0 )
+      return optional<index_entry>();
+
+   index_entry e;
+   int64_t index_pos = sizeof(e) * int64_t(block_num - 1);
+   _block_num_to_pos.clear();
+   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
+   if( _block_num_to_pos.tellg() < index_pos + int64_t(sizeof(e)) )
+      return optional<index_entry>();
+
+   _block_num_to_pos.seekg( index_pos );
+   _block_num_to_pos.read( (char*)&e, sizeof(e) );
+   if( _block_num_to_pos.gcount() != sizeof(e) || e.block_size == 0 )
+      return optional<index_entry>();
+
+   // After a crash the index may have reached the disk ahead of the blocks it points to
+   _blocks.clear();
+   _blocks.seekg( 0, _blocks.end );
+   if( int64_t(_blocks.tellg()) < int64_t(e.block_pos + e.block_size) )
+      return optional<index_entry>();
+   return e;
+}
+
+signed_block block_database::read_block( const index_entry& e )const
+{
+   vector<char> data( e.block_size );
+   _blocks.clear();
+   _blocks.seekg( e.block_pos );
+   _blocks.read( data.data(), e.block_size );
+   FC_ASSERT( _blocks.gcount() == e.block_size, "Block log is truncated", ("pos", e.block_pos)("size", e.block_size) );
+   auto block = fc::raw::unpack<signed_block>( data );
+   FC_ASSERT( block.id() == e.block_id, "Block log entry does not match the block it points to",
+              ("pos", e.block_pos)("size", e.block_size)("id", e.block_id) );
+   return block;
+}
+
+} }
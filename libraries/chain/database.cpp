@@ -40,11 +40,17 @@
 #include <fc/io/raw.hpp>
 #include <fc/crypto/digest.hpp>
 #include <fc/container/flat.hpp>
+#include <fc/thread/thread.hpp>
 #include <fc/uint128.hpp>
 
 #include <boost/type_traits/make_unsigned.hpp>
 #include <boost/multiprecision/detail/bitscan.hpp>
 
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
 namespace bts { namespace chain {
 
 database::database()
@@ -64,6 +70,7 @@ void database::close(uint32_t blocks_to_rewind)
 
    for(uint32_t i = 0; i < blocks_to_rewind && head_block_num() > 0; ++i)
       pop_block();
+   _popped_tx.clear();
 
    object_database::close();
 
@@ -91,8 +98,15 @@ void database::open( const fc::path& data_dir, const genesis_allocation& initial
 { try {
    ilog("Open database in ${d}", ("d", data_dir));
    object_database::open( data_dir );
+   // objects loaded from disk bypass the index observers
+   _vote_tallies_valid = false;
+   _market_depth->rebuild( *this );
 
-   _block_id_to_block.open( data_dir / "database" / "block_num_to_block" );
+   auto legacy_block_store = data_dir / "database" / "block_num_to_block";
+   bool migrate_blocks = fc::exists( legacy_block_store ) && !fc::exists( data_dir / "database" / "block_log" );
+   _block_id_to_block.open( data_dir / "database" / "block_log" );
+   if( migrate_blocks )
+      migrate_legacy_block_store( legacy_block_store );
 
    if( !find(global_property_id_type()) )
       init_genesis(initial_allocation);
@@ -100,33 +114,107 @@ void database::open( const fc::path& data_dir, const genesis_allocation& initial
    _pending_block.previous  = head_block_id();
    _pending_block.timestamp = head_block_time();
 
-   auto last_block_itr = _block_id_to_block.last();
-   if( last_block_itr.valid() )
-      _fork_db.start_block( last_block_itr.value() );
+   // The object graph on disk reflects the last checkpoint; if we were not shut down cleanly, blocks may have been
+   // stored after it was taken.
+   replay_blocks_after_head();
+   _last_checkpoint_num = head_block_num();
+
+   auto head_block = _block_id_to_block.fetch_optional( head_block_id() );
+   if( head_block.valid() )
+      _fork_db.start_block( *head_block );
 
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
 
-void database::reindex(fc::path data_dir, const genesis_allocation& initial_allocation)
+void database::migrate_legacy_block_store( const fc::path& legacy_dir )
 { try {
-   wipe(data_dir, false);
-   open(data_dir, initial_allocation);
+   // Older nodes kept every block, including those of abandoned forks, in a leveldb map keyed by block id.  Walking
+   // back from the head finds the current chain; without an object graph yet, the highest stored block is the head.
+   bts::db::level_map<block_id_type, signed_block> legacy_blocks;
+   legacy_blocks.open( legacy_dir );
+   block_id_type id = head_block_id();
+   if( head_block_num() == 0 || !legacy_blocks.find( id ).valid() )
+   {
+      auto last = legacy_blocks.last();
+      if( !last.valid() )
+         return;
+      id = last.key();
+   }
+
+   ilog( "Migrating the blocks ending with ${id} from ${dir}", ("id", id)("dir", legacy_dir) );
+   uint32_t migrated = 0;
+   for( auto itr = legacy_blocks.find( id ); itr.valid(); itr = legacy_blocks.find( id ) )
+   {
+      auto block = itr.value();
+      _block_id_to_block.store( id, block );
+      ++migrated;
+      if( block.block_num() == 1 )
+         break;
+      id = block.previous;
+   }
+   _block_id_to_block.flush();
+   legacy_blocks.close();
+   ilog( "Migrated ${n} blocks; ${dir} may now be removed", ("n", migrated)("dir", legacy_dir) );
+} FC_CAPTURE_AND_RETHROW( (legacy_dir) ) }
+
+void database::replay_blocks_after_head()
+{ try {
+   if( head_block_num() > 0 )
+      FC_ASSERT( _block_id_to_block.contains( head_block_id() ),
+                 "Checkpointed head block is not in the block database; restart with --replay-blockchain",
+                 ("head", head_block_id()) );
 
    auto start = fc::time_point::now();
-   auto itr = _block_id_to_block.begin();
-   // TODO: disable undo tracking durring reindex, this currently causes crashes in the benchmark test
-   //_undo_db.disable();
-   while( itr.valid() )
+   uint32_t replayed = 0;
+   _last_checkpoint_num = head_block_num();
+   // TODO: disable undo tracking durring replay, this currently causes crashes in the benchmark test
+   while( true )
    {
-      apply_block( itr.value(), skip_delegate_signature |
+      // If we crashed part way through a fork switch the stored block may not link to our head, and if we crashed
+      // while blocks were being written the log may end in a torn one; stop at either.
+      optional<signed_block> next_block;
+      try {
+         next_block = _block_id_to_block.fetch_by_number( head_block_num() + 1 );
+      } catch( const fc::exception& e ) {
+         wlog( "Unable to read block ${n} after the last checkpoint: ${e}",
+               ("n", head_block_num() + 1)("e", e.to_detail_string()) );
+      }
+      if( !next_block || next_block->previous != head_block_id() )
+         break;
+
+      apply_block( *next_block, skip_delegate_signature |
                                 skip_transaction_signatures |
                                 skip_undo_block |
                                 skip_undo_transaction |
                                 skip_transaction_dupe_check |
                                 skip_tapos_check |
                                 skip_authority_check );
-      ++itr;
+      ++replayed;
+
+      if( _checkpoint_interval > 0 && head_block_num() >= _last_checkpoint_num + _checkpoint_interval )
+         checkpoint();
    }
-   //_undo_db.enable();
+
+   if( replayed > 0 )
+      ilog( "Replayed ${n} blocks after the last checkpoint in ${t} milliseconds.",
+            ("n", replayed)("t", (fc::time_point::now() - start).count() / 1000) );
+} FC_CAPTURE_AND_RETHROW() }
+
+void database::checkpoint()
+{ try {
+   FC_ASSERT( !_pending_block_session, "Cannot checkpoint while pending transactions are applied" );
+   // The object graph refers to its head block, which must be durable before the graph is
+   _block_id_to_block.flush();
+   flush();
+   _last_checkpoint_num = head_block_num();
+} FC_CAPTURE_AND_RETHROW() }
+
+void database::reindex(fc::path data_dir, const genesis_allocation& initial_allocation)
+{ try {
+   wipe(data_dir, false);
+
+   // With the object graph wiped, open() rebuilds it from genesis and replays every block linking onto it
+   auto start = fc::time_point::now();
+   open(data_dir, initial_allocation);
    auto end = fc::time_point::now();
    wdump( ((end-start).count()/1000000.0) );
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
@@ -206,6 +294,30 @@ void database::initialize_indexes()
    add_index< primary_index<simple_index< account_statistics_object      >> >();
    add_index< primary_index<simple_index< asset_dynamic_data_object      >> >();
    add_index< primary_index<flat_index<   block_summary_object           >> >();
+
+   _call_check_cache.clear();
+   auto call_check = std::make_shared<call_check_observer>( *this );
+   get_mutable_index_type< primary_index<limit_order_index> >().add_observer( call_check );
+   get_mutable_index_type< primary_index<short_order_index> >().add_observer( call_check );
+   get_mutable_index_type< primary_index<call_order_index> >().add_observer( call_check );
+   get_mutable_index_type< primary_index<asset_bitasset_data_index> >().add_observer( call_check );
+
+   _vote_tallies_valid = false;
+   auto vote_tally = std::make_shared<vote_tally_observer>( *this );
+   get_mutable_index_type< primary_index<account_index> >().add_observer( vote_tally );
+   get_mutable_index_type< primary_index<simple_index<vesting_balance_object>> >().add_observer( vote_tally );
+   get_mutable_index_type< primary_index<account_balance_index> >().add_observer( vote_tally );
+   get_mutable_index_type< primary_index<simple_index<account_statistics_object>> >().add_observer( vote_tally );
+
+   if( !_market_depth )
+      _market_depth = std::make_shared<market_depth>();
+   _market_depth->rebuild( *this );
+   get_mutable_index_type< primary_index<limit_order_index> >().add_observer( _market_depth );
+   get_mutable_index_type< primary_index<short_order_index> >().add_observer( _market_depth );
+   get_mutable_index_type< primary_index<call_order_index> >().add_observer( _market_depth );
+
+   _authority_cache = std::make_shared<authority_cache>();
+   get_mutable_index_type< primary_index<account_index> >().add_observer( _authority_cache );
 }
 
 void database::init_genesis(const genesis_allocation& initial_allocation)
@@ -511,7 +623,76 @@ int database::match( const limit_order_object& bid, const short_order_object& as
 }
 
 /**
- *
+ * Invalidates entries of database::_call_check_cache when an order change may let the top ask cross the call trigger.
+ */
+class database::call_check_observer : public index_observer
+{
+   public:
+      call_check_observer( database& db ):_db(db){}
+
+      virtual void on_add( const object& obj )override    { on_change( obj ); }
+      virtual void on_modify( const object& obj )override { on_change( obj ); }
+      virtual void on_remove( const object& obj )override
+      {
+         if( obj.id.space() == implementation_ids )
+            _db._call_check_cache.clear();
+         else if( obj.id.type() == call_order_object_type )
+            _db._call_check_cache.erase( static_cast<const call_order_object&>(obj).debt_type() );
+         else
+         {
+            const auto& sell_price = obj.id.type() == limit_order_object_type
+                                   ? static_cast<const limit_order_object&>(obj).sell_price
+                                   : static_cast<const short_order_object&>(obj).sell_price;
+            auto itr = _db._call_check_cache.find( sell_price.base.asset_id );
+            // removing any order other than the top of the book leaves the top ask unchanged
+            if( itr != _db._call_check_cache.end() && itr->second.top_order && *itr->second.top_order == obj.id )
+               _db._call_check_cache.erase( itr );
+         }
+      }
+
+   private:
+      void on_change( const object& obj )
+      {
+         // bitasset data holds the feed; we don't know which asset it belongs to, so forget every market
+         if( obj.id.space() == implementation_ids )
+            _db._call_check_cache.clear();
+         else if( obj.id.type() == call_order_object_type )
+            _db._call_check_cache.erase( static_cast<const call_order_object&>(obj).debt_type() );
+         else if( obj.id.type() == limit_order_object_type )
+            on_ask_change( obj.id, static_cast<const limit_order_object&>(obj).sell_price );
+         else
+            on_ask_change( obj.id, static_cast<const short_order_object&>(obj).sell_price );
+      }
+
+      void on_ask_change( object_id_type id, const price& sell_price )
+      {
+         auto itr = _db._call_check_cache.find( sell_price.base.asset_id );
+         if( itr == _db._call_check_cache.end() ) return;
+         auto& state = itr->second;
+
+         // the top order may have moved down the book, so we no longer know what is at the front
+         if( state.top_order && *state.top_order == id )
+         {
+            _db._call_check_cache.erase( itr );
+            return;
+         }
+         if( sell_price.quote.asset_id != state.backing_asset || sell_price < state.call_limit )
+            return;
+         if( state.top_order && sell_price <= state.top_price )
+            return;
+
+         state.top_order = id;
+         state.top_price = sell_price;
+         if( state.call_trigger && !(sell_price > *state.call_trigger) )
+            _db._call_check_cache.erase( itr );
+      }
+
+      database& _db;
+};
+
+/**
+ *  Fills margin calls against the top of the book while it is at or below their call price.  Markets where the last
+ *  check found nothing to do are skipped until an order change could cross the call trigger; see _call_check_cache.
  */
 bool database::check_call_orders( const asset_object& mia )
 { try {
@@ -520,6 +701,63 @@ bool database::check_call_orders( const asset_object& mia )
     if( bitasset.current_feed.call_limit.is_null() ) return false;
     if( bitasset.options.prediction_market ) return false;
 
+    if( _disable_call_check_cache )
+       return match_call_orders( mia, bitasset );
+    if( _call_check_cache.find( mia.id ) != _call_check_cache.end() )
+       return false;
+
+    bool filled_short_or_limit = match_call_orders( mia, bitasset );
+    update_call_check_cache( mia );
+    return filled_short_or_limit;
+} FC_CAPTURE_AND_RETHROW() }
+
+/**
+ * Caches the front of the book for mia, provided it does not cross the call trigger.  This evaluates the first step
+ * of match_call_orders, so a cached market is exactly one in which match_call_orders would do nothing.
+ */
+void database::update_call_check_cache( const asset_object& mia )
+{
+    _call_check_cache.erase( mia.id );
+
+    const asset_bitasset_data_object& bitasset = mia.bitasset_data(*this);
+    if( bitasset.current_feed.call_limit.is_null() || bitasset.options.prediction_market ) return;
+
+    const auto& call_price_index = get_index_type<call_order_index>().indices().get<by_price>();
+    const auto& limit_price_index = get_index_type<limit_order_index>().indices().get<by_price>();
+    const auto& short_price_index = get_index_type<short_order_index>().indices().get<by_price>();
+
+    call_check_state state;
+    state.backing_asset = bitasset.short_backing_asset;
+    state.call_limit    = ~bitasset.current_feed.call_limit;
+
+    auto short_itr = short_price_index.lower_bound( price::max( mia.id, bitasset.short_backing_asset ) );
+    auto short_end = short_price_index.upper_bound( state.call_limit );
+    auto limit_itr = limit_price_index.lower_bound( price::max( mia.id, bitasset.short_backing_asset ) );
+    auto limit_end = limit_price_index.upper_bound( state.call_limit );
+
+    if( limit_itr != limit_end && !(short_itr != short_end && limit_itr->sell_price < short_itr->sell_price) )
+    {
+       state.top_order = limit_itr->id;
+       state.top_price = limit_itr->sell_price;
+    }
+    else if( short_itr != short_end )
+    {
+       state.top_order = short_itr->id;
+       state.top_price = short_itr->sell_price;
+    }
+
+    auto call_itr = call_price_index.lower_bound( price::min( bitasset.short_backing_asset, mia.id ) );
+    auto call_end = call_price_index.upper_bound( price::max( bitasset.short_backing_asset, mia.id ) );
+    if( call_itr != call_end )
+       state.call_trigger = ~call_itr->call_price;
+
+    if( state.top_order && state.call_trigger && !(state.top_price > *state.call_trigger) )
+       return;
+    _call_check_cache[mia.id] = state;
+}
+
+bool database::match_call_orders( const asset_object& mia, const asset_bitasset_data_object& bitasset )
+{ try {
     const call_order_index& call_index = get_index_type<call_order_index>();
     const auto& call_price_index = call_index.indices().get<by_price>();
 
@@ -645,6 +883,19 @@ void database::cancel_order( const limit_order_object& order, bool create_virtua
    remove( order );
 }
 
+void database::cancel_order( const short_order_object& order )
+{
+   auto refunded = order.get_collateral();
+
+   modify( order.seller(*this).statistics(*this),[&]( account_statistics_object& obj ){
+      if( refunded.asset_id == asset_id_type() )
+         obj.total_core_in_orders -= refunded.amount;
+   });
+   adjust_balance(order.seller, refunded);
+
+   remove( order );
+}
+
 /**
     for each short order, fill it at settlement price and place funds received into a total
     calculate the USD->BTS price and convert all USD balances to BTS at that price and subtract BTS from total
@@ -659,8 +910,6 @@ void database::cancel_order( const limit_order_object& order, bool create_virtua
 void database::globally_settle_asset( const asset_object& mia, const price& settlement_price )
 { try {
    elog( "BLACK SWAN!" );
-   debug_dump();
-
    edump( (mia.symbol)(settlement_price) );
 
    const asset_bitasset_data_object& bitasset = mia.bitasset_data(*this);
@@ -670,94 +919,71 @@ void database::globally_settle_asset( const asset_object& mia, const price& sett
    const asset_dynamic_data_object& mia_dyn = mia.dynamic_asset_data_id(*this);
    auto original_mia_supply = mia_dyn.current_supply;
 
-   const call_order_index& call_index = get_index_type<call_order_index>();
-   const auto& call_price_index = call_index.indices().get<by_price>();
+   // Each kind of order is visited in one pass over its range of the by_price index; every order in the range is
+   // removed, so the iterator is advanced before the order is touched.
 
-    auto call_itr = call_price_index.lower_bound( price::min( bitasset.short_backing_asset, mia.id ) );
-    auto call_end = call_price_index.upper_bound( price::max( bitasset.short_backing_asset, mia.id ) );
-    while( call_itr != call_end )
-    {
-       auto pays = call_itr->get_debt() * settlement_price;
-       wdump( (call_itr->get_debt() ) );
-       collateral_gathered += pays;
-       const auto&  order = *call_itr;
-       ++call_itr;
-       FC_ASSERT( fill_order( order, pays, order.get_debt() ) );
-    }
-
-   const limit_order_index& limit_index = get_index_type<limit_order_index>();
-   const auto& limit_price_index = limit_index.indices().get<by_price>();
-
-    // cancel all orders selling the market issued asset
-    auto limit_itr = limit_price_index.lower_bound( price::max( mia.id, bitasset.short_backing_asset ) );
-    auto limit_end = limit_price_index.upper_bound( ~bitasset.current_feed.call_limit );
-    while( limit_itr != limit_end )
-    {
-       const auto& order = *limit_itr;
-       ilog( "CANCEL LIMIT ORDER" );
-        idump((order));
-       ++limit_itr;
-       cancel_order( order );
-    }
+   // cover every call at the settlement price
+   const auto& call_price_index = get_index_type<call_order_index>().indices().get<by_price>();
+   auto call_itr = call_price_index.lower_bound( price::min( bitasset.short_backing_asset, mia.id ) );
+   auto call_end = call_price_index.upper_bound( price::max( bitasset.short_backing_asset, mia.id ) );
+   while( call_itr != call_end )
+   {
+      const auto& order = *call_itr;
+      ++call_itr;
+      auto pays = order.get_debt() * settlement_price;
+      collateral_gathered += pays;
+      FC_ASSERT( fill_order( order, pays, order.get_debt() ) );
+   }
 
-    limit_itr = limit_price_index.begin();
-    while( limit_itr != limit_end )
-    {
-       if( limit_itr->amount_for_sale().asset_id == mia.id )
-       {
-          const auto& order = *limit_itr;
-          ilog( "CANCEL_AGAIN" );
-          edump((order));
-          ++limit_itr;
-          cancel_order( order );
-       }
-    }
+   // cancel every short, as no more of the asset may be issued
+   const auto& short_price_index = get_index_type<short_order_index>().indices().get<by_price>();
+   auto short_itr = short_price_index.lower_bound( price::max( mia.id, bitasset.short_backing_asset ) );
+   auto short_end = short_price_index.upper_bound( price::min( mia.id, bitasset.short_backing_asset ) );
+   while( short_itr != short_end )
+   {
+      const auto& order = *short_itr;
+      ++short_itr;
+      cancel_order( order );
+   }
 
-   limit_itr = limit_price_index.begin();
+   // cancel every limit order selling the asset, whatever it asks for in return, so the asset they hold is settled
+   // with the balances below.  Prices are ordered by base asset first, so these orders are contiguous in the index.
+   const auto& limit_price_index = get_index_type<limit_order_index>().indices().get<by_price>();
+   auto limit_itr = limit_price_index.lower_bound( price::max( mia.id, get_index_type<asset_index>().get_next_id() ) );
+   auto limit_end = limit_price_index.upper_bound( price::min( mia.id, asset_id_type() ) );
    while( limit_itr != limit_end )
    {
-      if( limit_itr->amount_for_sale().asset_id == mia.id )
-      {
-         const auto& order = *limit_itr;
-         edump((order));
-         ++limit_itr;
-         cancel_order( order );
-      }
+      const auto& order = *limit_itr;
+      ++limit_itr;
+      cancel_order( order );
    }
 
     // settle all balances
     asset total_mia_settled = mia.amount(0);
 
-   // convert collateral held in bonds
+    // convert collateral held in bonds; each conversion moves the bond out of the asset's by_collateral group,
+    // so look the group up again rather than walking it
     const auto& bond_idx = get_index_type<bond_index>().indices().get<by_collateral>();
-    auto bond_itr = bond_idx.find( bitasset.id );
-    while( bond_itr != bond_idx.end() )
+    for( auto bond_itr = bond_idx.find( mia.get_id() ); bond_itr != bond_idx.end();
+         bond_itr = bond_idx.find( mia.get_id() ) )
     {
-       if( bond_itr->collateral.asset_id == bitasset.id )
-       {
-          auto settled_amount = bond_itr->collateral * settlement_price;
-          total_mia_settled += bond_itr->collateral;
-          collateral_gathered -= settled_amount;
-          modify( *bond_itr, [&]( bond_object& obj ) {
-                  obj.collateral = settled_amount;
-                  });
-       }
-       else break;
+       const bond_object& bond = *bond_itr;
+       auto settled_amount = bond.collateral * settlement_price;
+       total_mia_settled += bond.collateral;
+       collateral_gathered -= settled_amount;
+       modify( bond, [&]( bond_object& obj ) {
+               obj.collateral = settled_amount;
+               });
     }
 
     // cancel all bond offers holding the bitasset and refund the offer
     const auto& bond_offer_idx = get_index_type<bond_offer_index>().indices().get<by_asset>();
-    auto bond_offer_itr = bond_offer_idx.find( bitasset.id );
-    while( bond_offer_itr != bond_offer_idx.end() )
+    for( auto bond_offer_itr = bond_offer_idx.find( mia.get_id() ); bond_offer_itr != bond_offer_idx.end();
+         bond_offer_itr = bond_offer_idx.find( mia.get_id() ) )
     {
-       if( bond_offer_itr->amount.asset_id == bitasset.id )
-       {
-          adjust_balance( bond_offer_itr->offered_by_account, bond_offer_itr->amount );
-          auto old_itr = bond_offer_itr;
-          bond_offer_itr++;
-          remove( *old_itr );
-       }
-       else break;
+       const bond_offer_object& offer = *bond_offer_itr;
+       adjust_balance( offer.offered_by_account, offer.amount );
+       remove( offer );
     }
 
     const auto& index = get_index_type<account_balance_index>().indices().get<by_asset>();
@@ -1161,8 +1387,9 @@ asset database::current_delegate_registration_fee()const
 void database::apply_block( const signed_block& next_block, uint32_t skip )
 { try {
    _applied_ops.clear();
+   _authority_cache->clear();
 
-   FC_ASSERT( (skip & skip_merkle_check) || next_block.transaction_merkle_root == next_block.calculate_merkle_root() );
+   FC_ASSERT( (skip & skip_merkle_check) || next_block.transaction_merkle_root == calculate_merkle_root( next_block ) );
 
    const witness_object& signing_witness = validate_block_header(skip, next_block);
    const auto& global_props = get_global_properties();
@@ -1209,10 +1436,13 @@ void database::apply_block( const signed_block& next_block, uint32_t skip )
    // notify observers that the block has been applied
    applied_block( next_block ); //emit
    _applied_ops.clear();
+   _market_depth->clear_changes();
 
    const auto& head_undo = _undo_db.head();
-   vector<object_id_type> changed_ids;  changed_ids.reserve(head_undo.old_values.size());
-   for( const auto& item : head_undo.old_values ) changed_ids.push_back(item.first);
+   vector<object_id_type> changed_ids;  changed_ids.reserve(head_undo.changes.size());
+   for( const auto& change : head_undo.changes )
+      if( change.type == undo_change::modified )
+         changed_ids.push_back(change.id);
    changed_objects(changed_ids);
 
 
@@ -1268,7 +1498,7 @@ signed_block database::generate_block(
    fc::raw::pack( next_enc, _pending_block.previous_secret );
    _pending_block.next_secret_hash = secret_hash_type::hash(next_enc.result());
 
-   _pending_block.transaction_merkle_root = _pending_block.calculate_merkle_root();
+   _pending_block.transaction_merkle_root = signed_block::calculate_merkle_root( _pending_merkle_digests );
 
    _pending_block.witness = witness_id;
    if( !(skip & skip_delegate_signature) ) _pending_block.sign( block_signing_private_key );
@@ -1277,9 +1507,10 @@ signed_block database::generate_block(
    //This line used to std::move(_pending_block) but this is unsafe as _pending_block is later referenced without being
    //reinitialized. Future optimization could be to move it, then reinitialize it with the values we need to preserve.
    signed_block tmp = _pending_block;
-   tmp.transaction_merkle_root = tmp.calculate_merkle_root();
    _pending_block.transactions.clear();
-   push_block( tmp, skip );
+   _pending_merkle_digests.clear();
+   // the merkle root was just calculated from these very transactions
+   push_block( tmp, skip | skip_merkle_check );
    return tmp;
 } FC_CAPTURE_AND_RETHROW( (witness_id) ) }
 
@@ -1326,37 +1557,50 @@ void database::update_active_delegates()
 
    // Update genesis authorities
    if( !delegates.empty() )
-      modify( get(account_id_type()), [&]( account_object& a ) {
-         uint64_t total_votes = 0;
-         map<account_id_type, uint64_t> weights;
-         a.owner.weight_threshold = 0;
-         a.owner.auths.clear();
+   {
+      uint64_t total_votes = 0;
+      map<account_id_type, uint64_t> weights;
+      authority genesis_authority;
 
-         for( const delegate_object& del : delegates )
-         {
-            weights.emplace(del.delegate_account, _vote_tally_buffer[del.vote_id]);
-            total_votes += _vote_tally_buffer[del.vote_id];
-         }
+      for( const delegate_object& del : delegates )
+      {
+         weights.emplace(del.delegate_account, _vote_tally_buffer[del.vote_id]);
+         total_votes += _vote_tally_buffer[del.vote_id];
+      }
 
-         // total_votes is 64 bits. Subtract the number of leading low bits from 64 to get the number of useful bits,
-         // then I want to keep the most significant 16 bits of what's left.
+      // total_votes is 64 bits. Subtract the number of leading low bits from 64 to get the number of useful bits,
+      // then I want to keep the most significant 16 bits of what's left.
 #ifdef __GNUC__
-         int8_t bits_to_drop = std::max(int(64 - __builtin_clzll(total_votes)) - 16, 0);
+      int8_t bits_to_drop = std::max(int(64 - __builtin_clzll(total_votes)) - 16, 0);
 #else
-         int8_t bits_to_drop = std::max(int(boost::multiprecision::detail::find_msb(total_votes.value)) - 15, 0);
+      int8_t bits_to_drop = std::max(int(boost::multiprecision::detail::find_msb(total_votes.value)) - 15, 0);
 #endif
-         for( const auto& weight : weights )
-         {
-            // Ensure that everyone has at least one vote. Zero weights aren't allowed.
-            uint16_t votes = std::max((weight.second >> bits_to_drop), uint64_t(1) );
-            a.owner.auths[weight.first] += votes;
-            a.owner.weight_threshold += votes;
-         }
+      for( const auto& weight : weights )
+      {
+         // Ensure that everyone has at least one vote. Zero weights aren't allowed.
+         uint16_t votes = std::max((weight.second >> bits_to_drop), uint64_t(1) );
+         genesis_authority.auths[weight.first] += votes;
+         genesis_authority.weight_threshold += votes;
+      }
 
-         a.owner.weight_threshold /= 2;
-         a.owner.weight_threshold += 1;
-         a.active = a.owner;
-      });
+      genesis_authority.weight_threshold /= 2;
+      genesis_authority.weight_threshold += 1;
+
+      // Only a change of the authorities invalidates what was derived from them, such as proposal approval tallies
+      const account_object& genesis = get(account_id_type());
+      if( !(genesis.owner == genesis_authority && genesis.active == genesis_authority) )
+      {
+         const auto& dynamic_props = get_dynamic_global_properties();
+         modify( dynamic_props, []( dynamic_global_property_object& dgp ) {
+            ++dgp.authority_revision;
+         });
+         modify( genesis, [&]( account_object& a ) {
+            a.owner = genesis_authority;
+            a.active = genesis_authority;
+            a.authority_revision = dynamic_props.authority_revision;
+         });
+      }
+   }
    modify( get_global_properties(), [&]( global_property_object& gp ) {
       gp.active_delegates.clear();
       std::transform(delegates.begin(), delegates.end(),
@@ -1392,6 +1636,9 @@ void database::update_global_dynamic_data( const signed_block& b )
 void database::pop_block()
 { try {
    _pending_block_session.reset();
+   auto popped = fetch_block_by_id( _pending_block.previous );
+   FC_ASSERT( popped.valid(), "Unable to find the head block", ("id", _pending_block.previous) );
+   _popped_tx.insert( _popped_tx.begin(), popped->transactions.begin(), popped->transactions.end() );
    _block_id_to_block.remove( _pending_block.previous );
    pop_undo();
    _pending_block.previous  = head_block_id();
@@ -1402,12 +1649,14 @@ void database::pop_block()
 void database::clear_pending()
 { try {
    _pending_block.transactions.clear();
+   _pending_merkle_digests.clear();
    _pending_block_session.reset();
+   _popped_tx.clear();
 } FC_CAPTURE_AND_RETHROW() }
 
 bool database::is_known_block( const block_id_type& id )const
 {
-   return _fork_db.is_known_block(id) || _block_id_to_block.find(id).valid();
+   return _fork_db.is_known_block(id) || _block_id_to_block.contains(id);
 }
 /**
  * Only return true *if* the transaction has not expired or been invalidated. If this
@@ -1420,71 +1669,223 @@ bool database::is_known_transaction( const transaction_id_type& id )const
    return trx_idx.find( id ) != trx_idx.end();
 }
 
-void database::update_vote_totals(const global_property_object& props)
-{ try {
-   _vote_tally_buffer.resize(props.next_available_vote_id);
-   _witness_count_histogram_buffer.resize(props.parameters.maximum_witness_count / 2 + 1);
-   _committee_count_histogram_buffer.resize(props.parameters.maximum_committee_count / 2 + 1);
+/**
+ * Marks the accounts whose voting stake or opinions are affected by a change to an account, its core balance, its
+ * statistics or its vesting balances.
+ */
+class database::vote_tally_observer : public index_observer
+{
+   public:
+      vote_tally_observer( database& db ):_db(db){}
 
-   const account_index& account_idx = get_index_type<account_index>();
-   _total_voting_stake = 0;
+      virtual void on_add( const object& obj )override    { mark( obj ); }
+      virtual void on_modify( const object& obj )override { mark( obj ); }
+      virtual void on_remove( const object& obj )override { mark( obj ); }
 
-   bool count_non_prime_votes = props.parameters.count_non_prime_votes;
-   auto timestamp = fc::time_point::now();
-   for( const account_object& stake_account : account_idx.indices() )
-   {
-      if( count_non_prime_votes || stake_account.is_prime() )
+   private:
+      void mark( const object& obj )
       {
-         // There may be a difference between the account whose stake is voting and the one specifying opinions.
-         // Usually they're the same, but if the stake account has specified a voting_account, that account is the one
-         // specifying the opinions.
-         const account_object& opinion_account =
-               (stake_account.voting_account == account_id_type())? stake_account
-                                                                  : get(stake_account.voting_account);
-
-         const auto& stats = stake_account.statistics(*this);
-         uint64_t voting_stake = stats.total_core_in_orders.value
-               + (stake_account.cashback_vb.valid() ? (*stake_account.cashback_vb)(*this).balance.amount.value: 0)
-               + get_balance(stake_account.get_id(), asset_id_type()).amount.value;
-
-         for( vote_id_type id : opinion_account.votes )
+         // the next maintenance rebuilds everything anyway
+         if( !_db._vote_tallies_valid ) return;
+
+         if( obj.id.space() == protocol_ids )
          {
-            uint32_t offset = id.instance();
-            // if they somehow managed to specify an illegal offset, ignore it.
-            if( offset < _vote_tally_buffer.size() )
-               _vote_tally_buffer[ offset ] += voting_stake;
+            if( obj.id.type() == account_object_type )
+               _db._dirty_voters.insert( obj.id );
+            else
+               _db._dirty_voters.insert( static_cast<const vesting_balance_object&>(obj).owner );
          }
-
-         if( opinion_account.num_witness <= props.parameters.maximum_witness_count )
+         else if( obj.id.type() == impl_account_balance_object_type )
+         {
+            const auto& balance = static_cast<const account_balance_object&>(obj);
+            if( balance.asset_type == asset_id_type() )
+               _db._dirty_voters.insert( balance.owner );
+         }
+         else
          {
-            uint16_t offset = std::min(size_t(opinion_account.num_witness/2),
-                                       _witness_count_histogram_buffer.size() - 1);
-            //
-            // votes for a number greater than maximum_witness_count
-            // are turned into votes for maximum_witness_count.
-            //
-            // in particular, this takes care of the case where a
-            // member was voting for a high number, then the
-            // parameter was lowered.
-            //
-            _witness_count_histogram_buffer[ offset ] += voting_stake;
+            // a new account's statistics are not known yet, but the account itself is already dirty
+            auto itr = _db._statistics_owners.find( obj.id );
+            if( itr != _db._statistics_owners.end() )
+               _db._dirty_voters.insert( itr->second );
          }
-         if( opinion_account.num_committee <= props.parameters.maximum_committee_count )
+      }
+
+      database& _db;
+};
+
+void database::reset_vote_tallies()
+{
+   _dirty_voters.clear();
+   _statistics_owners.clear();
+   _voter_stakes.clear();
+   _opinion_tallies.clear();
+   std::fill( _vote_tallies.begin(), _vote_tallies.end(), 0 );
+   _overflow_vote_tallies.clear();
+   _witness_count_stake.clear();
+   _committee_count_stake.clear();
+   _tallied_voting_stake = 0;
+}
+
+void database::tally_opinion( const opinion_tally& opinion, uint64_t delta )
+{
+   for( vote_id_type id : opinion.votes )
+   {
+      uint32_t offset = id.instance();
+      if( offset < _vote_tallies.size() )
+         _vote_tallies[ offset ] += delta;
+      else
+         _overflow_vote_tallies[ offset ] += delta;
+   }
+   _witness_count_stake[ opinion.num_witness ] += delta;
+   _committee_count_stake[ opinion.num_committee ] += delta;
+}
+
+/**
+ * Brings the aggregates up to date with the current stake and opinions of account_id, by backing out whatever was
+ * last tallied for it and adding the new values.
+ */
+void database::tally_account( account_id_type account_id, bool count_non_prime_votes )
+{
+   const account_object* account = find( account_id );
+
+   // There may be a difference between the account whose stake is voting and the one specifying opinions.
+   // Usually they're the same, but if the stake account has specified a voting_account, that account is the one
+   // specifying the opinions.
+   voter_stake voter;
+   voter.opinion_account = account_id;
+   if( account )
+   {
+      _statistics_owners[ account->statistics ] = account_id;
+      if( account->voting_account != account_id_type() )
+         voter.opinion_account = account->voting_account;
+      if( count_non_prime_votes || account->is_prime() )
+      {
+         const auto* stats = find( account->statistics );
+         const vesting_balance_object* cashback = account->cashback_vb.valid() ? find( *account->cashback_vb ) : nullptr;
+         voter.stake = (stats ? stats->total_core_in_orders.value : 0)
+               + (cashback ? cashback->balance.amount.value : 0)
+               + get_balance( account_id, asset_id_type() ).amount.value;
+      }
+   }
+
+   auto voter_itr = _voter_stakes.find( account_id );
+   voter_stake old_voter = voter_itr == _voter_stakes.end() ? voter_stake() : voter_itr->second;
+   if( old_voter.stake != voter.stake || old_voter.opinion_account != voter.opinion_account )
+   {
+      if( old_voter.stake )
+      {
+         auto& opinion = _opinion_tallies[ old_voter.opinion_account ];
+         tally_opinion( opinion, -old_voter.stake );
+         opinion.delegated_stake -= old_voter.stake;
+         if( opinion.delegated_stake == 0 )
+            _opinion_tallies.erase( old_voter.opinion_account );
+      }
+      if( voter.stake )
+      {
+         auto opinion_itr = _opinion_tallies.find( voter.opinion_account );
+         if( opinion_itr == _opinion_tallies.end() )
          {
-            uint16_t offset = std::min(size_t(opinion_account.num_committee/2),
-                                       _committee_count_histogram_buffer.size() - 1);
-            //
-            // votes for a number greater than maximum_committee_count
-            // are turned into votes for maximum_committee_count.
-            //
-            // same rationale as for witnesses
-            //
-            _committee_count_histogram_buffer[ offset ] += voting_stake;
+            opinion_tally opinion;
+            if( const account_object* opinion_account = find( voter.opinion_account ) )
+            {
+               opinion.votes         = opinion_account->votes;
+               opinion.num_witness   = opinion_account->num_witness;
+               opinion.num_committee = opinion_account->num_committee;
+            }
+            opinion_itr = _opinion_tallies.emplace( voter.opinion_account, std::move(opinion) ).first;
          }
+         tally_opinion( opinion_itr->second, voter.stake );
+         opinion_itr->second.delegated_stake += voter.stake;
+      }
+      _tallied_voting_stake += voter.stake - old_voter.stake;
 
-         _total_voting_stake += voting_stake;
+      if( voter.stake )
+         _voter_stakes[ account_id ] = voter;
+      else if( voter_itr != _voter_stakes.end() )
+         _voter_stakes.erase( voter_itr );
+   }
+
+   // Re-apply the stake voting with this account's opinions if they have changed
+   auto opinion_itr = _opinion_tallies.find( account_id );
+   if( opinion_itr == _opinion_tallies.end() )
+      return;
+   auto& opinion = opinion_itr->second;
+   static const flat_set<vote_id_type> no_votes;
+   const auto& votes         = account ? account->votes : no_votes;
+   uint16_t    num_witness   = account ? account->num_witness : 0;
+   uint16_t    num_committee = account ? account->num_committee : 0;
+   if( opinion.votes != votes || opinion.num_witness != num_witness || opinion.num_committee != num_committee )
+   {
+      tally_opinion( opinion, -opinion.delegated_stake );
+      opinion.votes         = votes;
+      opinion.num_witness   = num_witness;
+      opinion.num_committee = num_committee;
+      tally_opinion( opinion, opinion.delegated_stake );
+   }
+}
+
+void database::update_vote_totals(const global_property_object& props)
+{ try {
+   auto timestamp = fc::time_point::now();
+   bool count_non_prime_votes = props.parameters.count_non_prime_votes;
+
+   if( _vote_tallies.size() < props.next_available_vote_id )
+   {
+      _vote_tallies.resize( props.next_available_vote_id );
+      for( auto itr = _overflow_vote_tallies.begin(); itr != _overflow_vote_tallies.end(); )
+      {
+         if( itr->first >= _vote_tallies.size() )
+         {
+            ++itr;
+            continue;
+         }
+         _vote_tallies[ itr->first ] += itr->second;
+         itr = _overflow_vote_tallies.erase( itr );
       }
    }
+
+   if( !_vote_tallies_valid || count_non_prime_votes != _tallied_non_prime_votes )
+   {
+      reset_vote_tallies();
+      for( const account_object& stake_account : get_index_type<account_index>().indices() )
+         tally_account( stake_account.id, count_non_prime_votes );
+      _vote_tallies_valid = true;
+      _tallied_non_prime_votes = count_non_prime_votes;
+   }
+   else
+   {
+      for( account_id_type id : _dirty_voters )
+         tally_account( id, count_non_prime_votes );
+   }
+   _dirty_voters.clear();
+
+   _vote_tally_buffer.assign( _vote_tallies.begin(), _vote_tallies.begin() + props.next_available_vote_id );
+   _witness_count_histogram_buffer.assign( props.parameters.maximum_witness_count / 2 + 1, 0 );
+   _committee_count_histogram_buffer.assign( props.parameters.maximum_committee_count / 2 + 1, 0 );
+
+   for( const auto& item : _witness_count_stake )
+   {
+      //
+      // votes for a number greater than maximum_witness_count
+      // are turned into votes for maximum_witness_count.
+      //
+      // in particular, this takes care of the case where a
+      // member was voting for a high number, then the
+      // parameter was lowered.
+      //
+      if( item.first <= props.parameters.maximum_witness_count )
+         _witness_count_histogram_buffer[ std::min(size_t(item.first/2), _witness_count_histogram_buffer.size() - 1) ]
+               += item.second;
+   }
+   for( const auto& item : _committee_count_stake )
+   {
+      // same rationale as for witnesses
+      if( item.first <= props.parameters.maximum_committee_count )
+         _committee_count_histogram_buffer[ std::min(size_t(item.first/2), _committee_count_histogram_buffer.size() - 1) ]
+               += item.second;
+   }
+
+   _total_voting_stake = _tallied_voting_stake;
    ilog("Tallied votes in ${time} milliseconds.", ("time", (fc::time_point::now() - timestamp).count() / 1000.0));
 } FC_CAPTURE_AND_RETHROW() }
 
@@ -1600,16 +2001,74 @@ void database::process_budget()
  * Push block "may fail" in which case every partial change is unwound.  After
  * push block is successful the block is appended to the chain database on disk.
  *
+ * Pending transactions are set aside while the block is applied, together with
+ * the transactions of any blocks popped by a fork switch, and are then re-pushed
+ * onto the new head whether or not the block was accepted.  Blocks which are
+ * already known or do not link yet leave them untouched.
+ *
  * @return true if we switched forks as a result of this push.
  */
 bool database::push_block( const signed_block& new_block, uint32_t skip )
 { try {
+   if( !(skip&skip_fork_db) )
+   {
+      // Neither a block we already have nor one which does not link yet can change the head, so the pending state
+      // is left as it is.
+      if( _fork_db.is_known_block( new_block.id() ) )
+         return false;
+      if( _fork_db.head() && new_block.previous != block_id_type() && !_fork_db.is_known_block( new_block.previous ) )
+      {
+         // Only blocks signed by their witness are held, so that peers cannot fill the fork database with junk
+         if( !(skip&skip_delegate_signature) )
+         {
+            const witness_object* witness = find( new_block.witness );
+            FC_ASSERT( witness && new_block.validate_signee( witness->signing_key(*this).key() ),
+                       "Block ${id} does not link to a known block and is not signed by its witness",
+                       ("id", new_block.id())("witness", new_block.witness) );
+         }
+         _fork_db.push_block( new_block ); // holds the block and throws unlinkable_block
+      }
+   }
+
+   // Drop the pending session to reset the database to a clean head block state.
+   auto old_pending = std::move( _pending_block.transactions );
+   _pending_block.transactions.clear();
+   _pending_merkle_digests.clear();
+   _pending_block_session.reset();
+
+   bool switched_forks = false;
+   try {
+      switched_forks = _push_block( new_block, skip );
+   } catch( const fc::exception& ) {
+      restore_pending_transactions( std::move( old_pending ) );
+      throw;
+   }
+   // Readers on other threads see the new head from here on.  This waits until any fork switch is complete, so that
+   // they never see a block which is then popped, nor the pending transactions restored below.
+   publish_snapshot( head_block_num() );
+   restore_pending_transactions( std::move( old_pending ) );
+   return switched_forks;
+} FC_CAPTURE_AND_RETHROW( (new_block) ) }
+
+bool database::_push_block( const signed_block& new_block, uint32_t skip )
+{
+   // new_block, followed by any held blocks it linked onto the head, all of which extend the head in order
+   vector<const signed_block*> extending( 1, &new_block );
    if( !(skip&skip_fork_db) )
    {
       wdump((new_block.id())(new_block.previous));
       auto new_head = _fork_db.push_block( new_block );
+      vector<item_ptr> linked;
+      for( auto item = new_head; item && item->num > head_block_num(); item = item->prev.lock() )
+         linked.push_back( item );
+      if( !linked.empty() && linked.back()->data.previous == head_block_id() )
+      {
+         // linked ends with new_block itself
+         for( auto itr = linked.rbegin() + 1; itr != linked.rend(); ++itr )
+            extending.push_back( &(*itr)->data );
+      }
       //If the head block from the longest chain does not build off of the current head, we need to switch forks.
-      if( new_head->data.previous != head_block_id() )
+      else if( new_head->data.previous != head_block_id() )
       {
          edump((new_head->data.previous));
          //If the newly pushed block is the same height as head, we get head back in new_head
@@ -1637,7 +2096,7 @@ bool database::push_block( const signed_block& new_block, uint32_t skip )
                 try {
                    auto session = _undo_db.start_undo_session();
                    apply_block( (*ritr)->data, skip );
-                   _block_id_to_block.store( new_block.id(), (*ritr)->data );
+                   _block_id_to_block.store( (*ritr)->data.id(), (*ritr)->data );
                    session.commit();
                 }
                 catch ( const fc::exception& e ) { except = e; }
@@ -1662,7 +2121,7 @@ bool database::push_block( const signed_block& new_block, uint32_t skip )
                    {
                       auto session = _undo_db.start_undo_session();
                       apply_block( (*ritr)->data, skip );
-                      _block_id_to_block.store( new_block.id(), (*ritr)->data );
+                      _block_id_to_block.store( (*ritr)->data.id(), (*ritr)->data );
                       session.commit();
                    }
                    throw *except;
@@ -1674,24 +2133,61 @@ bool database::push_block( const signed_block& new_block, uint32_t skip )
       }
    }
 
-   // If there is a pending block session, then the database state is dirty with pending transactions.
-   // Drop the pending session to reset the database to a clean head block state.
-   // TODO: Preserve pending transactions, and re-apply any which weren't included in the new block.
-   clear_pending();
+   for( size_t i = 0; i < extending.size(); ++i )
+   {
+      const signed_block& block = *extending[i];
 
-   try {
-      auto session = _undo_db.start_undo_session();
-      apply_block( new_block, skip );
-      _block_id_to_block.store( new_block.id(), new_block );
-      session.commit();
-   } catch ( const fc::exception& e ) {
-      elog("Failed to push new block:\n${e}", ("e", e.to_detail_string()));
-      _fork_db.remove(new_block.id());
-      throw;
+      // We are in a clean head block state, which is the only state worth persisting
+      if( _checkpoint_interval > 0 && head_block_num() >= _last_checkpoint_num + _checkpoint_interval )
+         checkpoint();
+
+      try {
+         auto session = _undo_db.start_undo_session();
+         apply_block( block, skip );
+         _block_id_to_block.store( block.id(), block );
+         session.commit();
+      } catch ( const fc::exception& e ) {
+         elog("Failed to push new block:\n${e}", ("e", e.to_detail_string()));
+         // the blocks after this one build on it, so they are invalid too
+         for( size_t j = i; j < extending.size(); ++j )
+            _fork_db.remove( extending[j]->id() );
+         if( extending.size() > 1 )
+            _fork_db.set_head( _fork_db.fetch_block( head_block_id() ) );
+         // new_block itself was invalid; held blocks which fail are only dropped
+         if( i == 0 )
+            throw;
+         break;
+      }
    }
 
    return false;
-} FC_CAPTURE_AND_RETHROW( (new_block) ) }
+}
+
+void database::restore_pending_transactions( vector<processed_transaction> old_pending )
+{ try {
+   vector<signed_transaction> to_restore( std::make_move_iterator( _popped_tx.begin() ),
+                                          std::make_move_iterator( _popped_tx.end() ) );
+   _popped_tx.clear();
+   to_restore.reserve( to_restore.size() + old_pending.size() );
+   for( auto& trx : old_pending )
+      to_restore.push_back( std::move( trx ) );
+   if( to_restore.empty() )
+      return;
+
+   uint32_t dropped = 0;
+   for( const auto& trx : to_restore )
+   {
+      try {
+         push_transaction( trx );
+      } catch( const fc::exception& ) {
+         // already included in the new head, expired, or no longer valid on this fork
+         ++dropped;
+      }
+   }
+   if( dropped )
+      dlog( "Dropped ${n} of ${total} pending transactions after a change of head block",
+            ("n", dropped)("total", to_restore.size()) );
+} FC_CAPTURE_AND_RETHROW() }
 
 /**
  * Attempts to push the transaction into the pending queue
@@ -1711,12 +2207,21 @@ processed_transaction database::push_transaction( const signed_transaction& trx,
    auto session = _undo_db.start_undo_session();
    auto processed_trx = apply_transaction( trx, skip );
    _pending_block.transactions.push_back(processed_trx);
+   _pending_merkle_digests.push_back(processed_trx.merkle_digest());
 
    FC_ASSERT( (skip & skip_block_size_check) ||
               fc::raw::pack_size(_pending_block) <= get_global_properties().parameters.maximum_block_size );
 
    // The transaction applied successfully. Merge its changes into the pending block session.
    session.merge();
+
+   // Remember it for peers until it expires; the dedupe entry already holds its expiration.
+   recent_transaction recent{ trx.id(), _pending_block.timestamp + get_global_properties().parameters.maximum_time_until_expiration, trx };
+   const auto& dedupe_index = get_index_type<transaction_index>().indices().get<by_trx_id>();
+   auto dedupe_itr = dedupe_index.find(recent.trx_id);
+   if( dedupe_itr != dedupe_index.end() )
+      recent.expiration = dedupe_itr->expiration;
+   _recent_transactions.insert( std::move(recent) );
    return processed_trx;
 }
 
@@ -1760,7 +2265,9 @@ processed_transaction database::apply_transaction( const signed_transaction& trx
 { try {
    trx.validate();
    auto& trx_idx = get_mutable_index_type<transaction_index>();
-   auto trx_id = trx.id();
+   // serialize the transaction once for its id and whichever digest its signatures are checked against
+   const transaction_digests trx_digests( trx );
+   const auto& trx_id = trx_digests.id();
    FC_ASSERT( (skip & skip_transaction_dupe_check) ||
               trx_idx.indices().get<by_trx_id>().find(trx_id) == trx_idx.indices().get<by_trx_id>().end() );
    transaction_evaluation_state eval_state(this, skip&skip_authority_check );
@@ -1770,14 +2277,16 @@ processed_transaction database::apply_transaction( const signed_transaction& trx
    //This check is used only if this transaction has an absolute expiration time.
    if( !(skip & skip_transaction_signatures) && trx.relative_expiration == 0 )
    {
+      const auto& trx_digest = trx_digests.digest();
+      auto signees = trx.get_signature_addresses( trx_digest );
       for( const auto& sig : trx.signatures )
       {
-         FC_ASSERT( sig.first(*this).key_address() == fc::ecc::public_key( sig.second, trx.digest() ), "",
+         FC_ASSERT( sig.first(*this).key_address() == signees[sig.first], "",
                     ("trx",trx)
-                    ("digest",trx.digest())
+                    ("digest",trx_digest)
                     ("sig.first",sig.first)
                     ("key_address",sig.first(*this).key_address())
-                    ("addr", address(fc::ecc::public_key( sig.second, trx.digest() ))) );
+                    ("addr", signees[sig.first]) );
       }
    }
 
@@ -1801,9 +2310,10 @@ processed_transaction database::apply_transaction( const signed_transaction& trx
          //This is the signature check for transactions with relative expiration.
          if( !(skip & skip_transaction_signatures) )
          {
+            auto signees = trx.get_signature_addresses( trx_digests.digest(tapos_block_summary.block_id) );
             for( const auto& sig : trx.signatures )
             {
-               address trx_addr = fc::ecc::public_key(sig.second, trx.digest(tapos_block_summary.block_id));
+               const address& trx_addr = signees[sig.first];
                FC_ASSERT(sig.first(*this).key_address() == trx_addr,
                           "",
                           ("sig.first",sig.first)
@@ -1830,7 +2340,6 @@ processed_transaction database::apply_transaction( const signed_transaction& trx
       create<transaction_object>([&](transaction_object& transaction) {
          transaction.expiration = trx_expiration;
          transaction.trx_id = trx_id;
-         transaction.trx = trx;
       });
    }
 
@@ -1913,10 +2422,7 @@ block_id_type       database::head_block_id()const
 
 block_id_type  database::get_block_id_for_num( uint32_t block_num )const
 { try {
-   block_id_type lb; lb._hash[0] = htonl(block_num);
-   auto itr = _block_id_to_block.lower_bound( lb );
-   FC_ASSERT( itr.valid() && itr.key()._hash[0] == lb._hash[0] );
-   return itr.key();
+   return _block_id_to_block.fetch_block_id( block_num );
 } FC_CAPTURE_AND_RETHROW( (block_num) ) }
 
 optional<signed_block> database::fetch_block_by_id( const block_id_type& id )const
@@ -1932,21 +2438,14 @@ optional<signed_block> database::fetch_block_by_number( uint32_t num )const
    auto results = _fork_db.fetch_block_by_number(num);
    if( results.size() == 1 )
       return results[0]->data;
-   else
-   {
-      block_id_type lb; lb._hash[0] = htonl(num);
-      auto itr = _block_id_to_block.lower_bound( lb );
-      if( itr.valid() && itr.key()._hash[0] == lb._hash[0] )
-         return itr.value();
-   }
-   return optional<signed_block>();
+   return _block_id_to_block.fetch_by_number(num);
 }
 
 const signed_transaction& database::get_recent_transaction(const transaction_id_type& trx_id) const
 {
-   auto& index = get_index_type<transaction_index>().indices().get<by_trx_id>();
-   auto itr = index.find(trx_id);
-   FC_ASSERT(itr != index.end());
+   const auto& recent_index = _recent_transactions.get<by_trx_id>();
+   auto itr = recent_index.find(trx_id);
+   FC_ASSERT( itr != recent_index.end(), "Unknown or expired transaction", ("trx_id",trx_id) );
    return itr->trx;
 }
 
@@ -2000,10 +2499,61 @@ void database::update_pending_block(const signed_block& next_block, uint8_t curr
 {
    _pending_block.timestamp = next_block.timestamp + current_block_interval;
    _pending_block.previous = next_block.id();
-   auto old_pending_trx = std::move(_pending_block.transactions);
-   _pending_block.transactions.clear();
-   for( auto old_trx : old_pending_trx )
-      push_transaction( old_trx );
+}
+
+checksum_type database::calculate_merkle_root( const signed_block& b )const
+{
+   // below this, handing the transactions to the worker threads costs more than hashing them here
+   if( b.transactions.size() < 64 )
+      return b.calculate_merkle_root();
+
+   vector<digest_type> leaf_digests( b.transactions.size() );
+   run_in_parallel( b.transactions.size(), [&b, &leaf_digests]( size_t i ) {
+      leaf_digests[i] = b.transactions[i].merkle_digest();
+   } );
+   return signed_block::calculate_merkle_root( std::move(leaf_digests) );
+}
+
+void database::run_in_parallel( size_t count, const std::function<void(size_t)>& work )const
+{
+   if( count == 0 )
+      return;
+
+   if( _worker_threads.empty() )
+   {
+      auto thread_count = std::max( 1u, std::thread::hardware_concurrency() );
+      for( unsigned i = 0; i < thread_count; ++i )
+         _worker_threads.push_back( std::make_shared<fc::thread>( "chain worker " + fc::to_string(i) ) );
+   }
+
+   // Every worker handles an interleaved slice, so each index is only ever touched by one thread
+   auto worker_count = std::min( _worker_threads.size(), count );
+   std::mutex              mutex;
+   std::condition_variable all_done;
+   size_t                  workers_running = worker_count;
+   std::exception_ptr      failure;
+   for( size_t w = 0; w < worker_count; ++w )
+      _worker_threads[w]->async( [&, w, worker_count, count]() {
+         std::exception_ptr error;
+         try {
+            for( size_t i = w; i < count; i += worker_count )
+               work( i );
+         } catch( ... ) {
+            error = std::current_exception();
+         }
+         std::lock_guard<std::mutex> lock( mutex );
+         if( error && !failure )
+            failure = error;
+         if( --workers_running == 0 )
+            all_done.notify_one();
+      }, "run_in_parallel" );
+
+   // Block the calling thread rather than waiting on fc futures: those would yield, letting other tasks on the chain
+   // thread push transactions or blocks while the database is part way through a push.
+   std::unique_lock<std::mutex> lock( mutex );
+   all_done.wait( lock, [&]() { return workers_running == 0; } );
+   if( failure )
+      std::rethrow_exception( failure );
 }
 
 void database::perform_chain_maintenance(const signed_block& next_block, const global_property_object& global_props)
@@ -2060,9 +2610,10 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
       d.next_maintenance_time = next_maintenance_time;
    });
 
-   // Reset all BitAsset force settlement volumes to zero
-   for( const asset_bitasset_data_object* d : get_index_type<asset_bitasset_data_index>() )
-      modify(*d, [](asset_bitasset_data_object& d) { d.force_settled_volume = 0; });
+   // Reset BitAsset force settlement volumes to zero; only those force settled this interval need it
+   const auto& settled_index = get_index_type<asset_bitasset_data_index>().indices().get<by_force_settled_volume>();
+   while( !settled_index.empty() && settled_index.rbegin()->force_settled_volume > 0 )
+      modify(*settled_index.rbegin(), [](asset_bitasset_data_object& d) { d.force_settled_volume = 0; });
 
    // process_budget needs to run at the bottom because
    //   it needs to know the next_maintenance_time
@@ -2087,8 +2638,13 @@ void database::clear_expired_transactions()
    const auto& global_parameters = get_global_properties().parameters;
    auto forking_window_time = global_parameters.maximum_undo_history * global_parameters.block_interval;
    while( !dedupe_index.empty()
-          && head_block_time() - dedupe_index.rbegin()->expiration >= fc::seconds(forking_window_time) )
-      transaction_idx.remove(*dedupe_index.rbegin());
+          && head_block_time() - dedupe_index.begin()->expiration >= fc::seconds(forking_window_time) )
+      transaction_idx.remove(*dedupe_index.begin());
+
+   //Expired transactions can no longer be included in a block, so there is no reason to serve them to peers.
+   auto& recent_index = _recent_transactions.get<by_expiration>();
+   while( !recent_index.empty() && recent_index.begin()->expiration < head_block_time() )
+      recent_index.erase(recent_index.begin());
 }
 
 void database::clear_expired_proposals()
@@ -2139,77 +2695,102 @@ void database::clear_expired_orders()
       apply_operation(cancel_context, canceler);
    }
 
-   //Process expired force settlement orders
-   //TODO: Do this on an asset-by-asset basis, and skip the current asset if it's maximally settled or has settlements disabled
-   // or is a prediction_market
-   auto& settlement_index = get_index_type<force_settlement_index>().indices().get<by_expiration>();
-   if( !settlement_index.empty() )
+   //Process expired force settlement orders, one asset at a time
+   const auto& settlement_index = get_index_type<force_settlement_index>().indices().get<by_expiration>();
+   auto settle_itr = settlement_index.begin();
+   while( settle_itr != settlement_index.end() )
    {
-      asset_id_type current_asset = settlement_index.begin()->settlement_asset_id();
-      asset max_settlement_volume;
+      asset_id_type current_asset = settle_itr->settlement_asset_id();
+      execute_force_settlements( get(current_asset) );
+      settle_itr = settlement_index.upper_bound( boost::make_tuple( current_asset ) );
+   }
+}
 
-      // At each iteration, we either consume the current order and remove it, or we move to the next asset
-      for( auto itr = settlement_index.lower_bound(current_asset);
-           itr != settlement_index.end();
-           itr = settlement_index.lower_bound(current_asset) )
-      {
-         const force_settlement_object& order = *itr;
-         auto order_id = order.id;
-         current_asset = order.settlement_asset_id();
-         const asset_object& mia_object = get(current_asset);
-         const asset_bitasset_data_object mia = mia_object.bitasset_data(*this);
-
-         // Can we still settle in this asset?
-         if( max_settlement_volume.asset_id != current_asset )
-            max_settlement_volume = mia_object.amount(mia.max_force_settlement_volume(mia_object.dynamic_data(*this).current_supply));
-         if( mia.current_feed.settlement_price.is_null() || mia.force_settled_volume >= max_settlement_volume.amount )
-         {
-            ilog("Skipping force settlement in ${asset}; price is null: ${settlement_price_null}; settled "
-                 "${settled_volume} / ${max_volume}",
-                 ("asset", mia_object.symbol)("settlement_price_null",mia.current_feed.settlement_price.is_null())
-                 ("settled_volume", mia.force_settled_volume)("max_volume", max_settlement_volume));
-            auto bound = settlement_index.upper_bound(boost::make_tuple(current_asset));
-            if( bound == settlement_index.end() )
-               break;
-            current_asset = bound->settlement_asset_id();
-            continue;
-         }
+/**
+ * Executes the force settlements of mia which have reached their settlement date, oldest first, against the least
+ * collateralized calls.  The feed and the maximum settlement volume are looked up once, and we stop as soon as the
+ * volume is exhausted, so the settlements still waiting cost nothing.
+ *
+ * Hardfork: settlements used to be executed in the block after they were requested, whatever their settlement date;
+ * nodes without the settlement date check will not agree on the blocks that execute them.
+ */
+void database::execute_force_settlements( const asset_object& mia_object )
+{
+   const auto& settlement_index = get_index_type<force_settlement_index>().indices().get<by_expiration>();
+   const auto& call_index = get_index_type<call_order_index>().indices().get<by_collateral>();
+   const asset_bitasset_data_object& mia = mia_object.bitasset_data(*this);
+   const asset_id_type current_asset = mia_object.get_id();
+
+   auto is_due = [&]( decltype(settlement_index.begin()) itr ) -> bool {
+      return itr != settlement_index.end() && itr->settlement_asset_id() == current_asset &&
+             itr->settlement_date <= head_block_time();
+   };
+   if( !is_due( settlement_index.lower_bound( boost::make_tuple( current_asset ) ) ) )
+      return;
 
-         auto& pays = order.balance;
-         auto receives = (order.balance * mia.current_feed.settlement_price);
-         receives.amount = (fc::uint128_t(receives.amount.value) *
-                            (BTS_100_PERCENT - mia.options.force_settlement_offset_percent) / BTS_100_PERCENT).to_uint64();
-         assert(receives <= order.balance * mia.current_feed.settlement_price);
+   const asset max_settlement_volume = mia_object.amount(mia.max_force_settlement_volume(mia_object.dynamic_data(*this).current_supply));
+   const price feed_price = mia.current_feed.settlement_price;
+   if( feed_price.is_null() || mia.force_settled_volume >= max_settlement_volume.amount )
+   {
+      ilog("Skipping force settlement in ${asset}; price is null: ${settlement_price_null}; settled "
+           "${settled_volume} / ${max_volume}",
+           ("asset", mia_object.symbol)("settlement_price_null",feed_price.is_null())
+           ("settled_volume", mia.force_settled_volume)("max_volume", max_settlement_volume));
+      return;
+   }
+   const uint16_t offset_percent = mia.options.force_settlement_offset_percent;
+   const price least_collateralized = price::min(mia.short_backing_asset, current_asset);
 
-         price settlement_price = pays / receives;
+   asset settled = mia_object.amount(mia.force_settled_volume);
+   for( auto itr = settlement_index.lower_bound( boost::make_tuple( current_asset ) );
+        is_due( itr ) && settled < max_settlement_volume;
+        itr = settlement_index.lower_bound( boost::make_tuple( current_asset ) ) )
+   {
+      const force_settlement_object& order = *itr;
+      auto order_id = order.id;
 
-         auto& call_index = get_index_type<call_order_index>().indices().get<by_collateral>();
-         asset settled = mia_object.amount(mia.force_settled_volume);
-         // Match against the least collateralized short until the settlement is finished or we reach max settlements
-         while( settled < max_settlement_volume && find_object(order_id) )
-         {
-            auto itr = call_index.lower_bound(boost::make_tuple(price::min(mia_object.bitasset_data(*this).short_backing_asset,
-                                                                           mia_object.get_id())));
-            // There should always be a call order, since asset exists!
-            assert(itr != call_index.end() && itr->debt_type() == mia_object.get_id());
-            asset max_settlement = max_settlement_volume - settled;
-            settled += match(*itr, order, settlement_price, max_settlement);
-         }
-         modify(mia, [settled](asset_bitasset_data_object& b) {
-            b.force_settled_volume = settled.amount;
-         });
+      auto& pays = order.balance;
+      auto receives = (order.balance * feed_price);
+      receives.amount = (fc::uint128_t(receives.amount.value) *
+                         (BTS_100_PERCENT - offset_percent) / BTS_100_PERCENT).to_uint64();
+      assert(receives <= order.balance * feed_price);
+
+      price settlement_price = pays / receives;
+
+      // Match against the least collateralized short until the settlement is finished or we reach max settlements
+      while( settled < max_settlement_volume && find_object(order_id) )
+      {
+         auto call_itr = call_index.lower_bound(boost::make_tuple(least_collateralized));
+         // There should always be a call order, since asset exists!
+         assert(call_itr != call_index.end() && call_itr->debt_type() == current_asset);
+         asset max_settlement = max_settlement_volume - settled;
+         settled += match(*call_itr, order, settlement_price, max_settlement);
       }
    }
+   modify(mia, [settled](asset_bitasset_data_object& b) {
+      b.force_settled_volume = settled.amount;
+   });
 }
 
+/**
+ * Recomputes the median feed of each bitasset whose oldest contributing feed has expired.  Bitassets are indexed by
+ * that expiration time, so only the ones which need it are visited.
+ *
+ * Hardfork: feed_is_expired() used to hold while the oldest feed was still current, so the median was recomputed on
+ * every block until then and never after, leaving expired feeds in place.
+ */
 void database::update_expired_feeds()
 {
-   auto& asset_idx = get_index_type<asset_bitasset_data_index>();
-   for( const asset_bitasset_data_object* b : asset_idx )
-      if( b->feed_is_expired(head_block_time()) )
-         modify(*b, [this](asset_bitasset_data_object& a) {
-            a.update_median_feeds(head_block_time());
-         });
+   const auto& expiration_index = get_index_type<asset_bitasset_data_index>().indices().get<by_feed_expiration>();
+   // collected first, as recomputing moves a bitasset within the index (and with a feed lifetime of zero, would leave
+   // it expired)
+   vector<const asset_bitasset_data_object*> expired;
+   for( auto itr = expiration_index.begin(); itr != expiration_index.end() && itr->feed_is_expired(head_block_time()); ++itr )
+      expired.push_back( &*itr );
+   for( const asset_bitasset_data_object* b : expired )
+      modify(*b, [this](asset_bitasset_data_object& a) {
+         a.update_median_feeds(head_block_time());
+      });
 }
 
 void database::update_withdraw_permissions()
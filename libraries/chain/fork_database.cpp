@@ -1,4 +1,8 @@
 #include <bts/chain/fork_database.hpp>
+#include <bts/chain/config.hpp>
+#include <bts/chain/exceptions.hpp>
+
+#include <iterator>
 
 
 namespace bts { namespace chain {
@@ -9,6 +13,7 @@ void fork_database::reset()
 {
    _head.reset();
    _index.clear();
+   _unlinked_index.clear();
 }
 
 void fork_database::pop_block()
@@ -28,23 +33,84 @@ shared_ptr<fork_item>  fork_database::push_block( signed_block b )
    auto item = std::make_shared<fork_item>( std::move(b) );
    //wdump((item->num)(_head?_head->num:0));
 
-   if( _head && b.previous != block_id_type() )
+   if( _head && item->data.previous != block_id_type() )
    {
-      auto itr = _index.get<block_id>().find( b.previous );
-      FC_ASSERT( itr != _index.get<block_id>().end() );
+      auto itr = _index.get<block_id>().find( item->data.previous );
+      if( itr == _index.get<block_id>().end() )
+      {
+         _hold_unlinked( item );
+         FC_THROW_EXCEPTION( unlinkable_block, "block ${id} does not link to a known block; previous block ${prev} is missing",
+                             ("id", item->id)("prev", item->data.previous) );
+      }
       FC_ASSERT( !(*itr)->invalid );
       item->prev = *itr;
    }
 
+   _push_block( item );
+   _push_next( item );
+   return _head;
+}
+
+void fork_database::_push_block( const item_ptr& item )
+{
    _index.insert( item );
    if( !_head ) _head = item;
    else if( item->num > _head->num )
    {
       _head = item;
       _index.get<block_num>().erase( _head->num - 1024 );
+      // anything held that is this old could only link to a block we no longer track
+      auto& unlinked_by_num = _unlinked_index.get<block_num>();
+      if( _head->num > 1024 )
+         unlinked_by_num.erase( unlinked_by_num.begin(), unlinked_by_num.upper_bound( _head->num - 1024 ) );
+   }
+}
+
+/**
+ * Links every held block that builds on new_item, breadth first so that each block is linked after its parent.
+ */
+void fork_database::_push_next( const item_ptr& new_item )
+{
+   auto& prev_idx = _unlinked_index.get<by_previous>();
+   vector<item_ptr> linked( 1, new_item );
+   for( size_t i = 0; i < linked.size() && !_unlinked_index.empty(); ++i )
+   {
+      auto range = prev_idx.equal_range( linked[i]->id );
+      vector<item_ptr> children( range.first, range.second );
+      prev_idx.erase( range.first, range.second );
+      for( const auto& child : children )
+      {
+         child->prev = linked[i];
+         _push_block( child );
+         linked.push_back( child );
+      }
    }
-   return _head;
 }
+
+void fork_database::_hold_unlinked( const item_ptr& item )
+{
+   // a block this far from the head could never be linked before it was pruned again
+   if( item->num + 1024 <= _head->num || item->num > _head->num + BTS_MAX_UNLINKED_FORK_BLOCKS )
+      return;
+
+   auto& by_num = _unlinked_index.get<block_num>();
+   if( _unlinked_index.size() >= BTS_MAX_UNLINKED_FORK_BLOCKS )
+   {
+      // evict the block furthest ahead, as it will be the last to link
+      auto furthest = std::prev( by_num.end() );
+      if( (*furthest)->num <= item->num )
+         return;
+      by_num.erase( furthest );
+   }
+   _unlinked_index.insert( item );
+}
+
+bool fork_database::is_unlinked_block( const block_id_type& id )const
+{
+   auto& index = _unlinked_index.get<block_id>();
+   return index.find(id) != index.end();
+}
+
 bool fork_database::is_known_block( const block_id_type& id )const
 {
    auto& index = _index.get<block_id>();
@@ -118,6 +184,7 @@ void fork_database::set_head( shared_ptr<fork_item> h )
 void fork_database::remove( block_id_type id )
 {
    _index.get<block_id>().erase(id);
+   _unlinked_index.get<block_id>().erase(id);
 }
 
 } } // bts::chain
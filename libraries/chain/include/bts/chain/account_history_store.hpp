@@ -0,0 +1,108 @@
+#pragma once
+#include <bts/chain/operation_history_object.hpp>
+#include <bts/db/level_map.hpp>
+
+#include <tuple>
+
+namespace bts { namespace chain {
+
+   /**
+    * @class account_history_store
+    * @brief on-disk store of the operations relevant to each account, keyed by account and operation sequence number
+    *
+    * Every applied operation is assigned the next operation sequence number (which is also reported as its
+    * operation_history_id_type), and a copy is stored under (account, sequence) for each account it impacts.  Because
+    * an account's history is contiguous in key order, paging through it is a single seek followed by a scan, no matter
+    * how long the history is or how many other accounts there are.
+    *
+    * Only the leveldb block cache is held in memory, so the store's footprint is bounded by the cache size passed to
+    * open() rather than by the length of the chain.
+    *
+    * Blocks may be popped and re-applied (fork switches, or replaying after a checkpoint), so a journal of the keys
+    * written by each recent block is kept.  Storing block N first discards anything recorded for block N or later.
+    *
+    * History may optionally be pruned to the most recent max_ops_per_account operations of each account, and/or to the
+    * operations of the most recent max_age blocks.
+    */
+   class account_history_store
+   {
+      public:
+         struct history_key
+         {
+            history_key(){}
+            history_key( account_id_type a, uint64_t s ):account(a),sequence(s){}
+
+            account_id_type account;
+            uint64_t        sequence = 0;
+
+            friend bool operator < ( const history_key& a, const history_key& b )
+            {
+               return std::tie( a.account, a.sequence ) < std::tie( b.account, b.sequence );
+            }
+            friend bool operator == ( const history_key& a, const history_key& b )
+            {
+               return a.account == b.account && a.sequence == b.sequence;
+            }
+         };
+
+         /** the keys written while applying a block, so that they can be discarded if the block is popped */
+         struct block_journal_entry
+         {
+            uint64_t            next_sequence = 1; ///< the first sequence number available to the following block
+            vector<history_key> keys;
+         };
+
+         /** an applied operation and the accounts whose history it belongs in */
+         struct applied_operation
+         {
+            operation_history_object  op;
+            flat_set<account_id_type> accounts;
+         };
+
+         void open( const fc::path& dbdir, size_t cache_size = 0 );
+         bool is_open()const;
+         void close();
+         /** discard all stored history */
+         void wipe();
+
+         void set_max_ops_per_account( uint32_t max_ops ) { _max_ops_per_account = max_ops; }
+         /** history is journaled for at least BTS_DEFAULT_MAX_UNDO_HISTORY blocks, so it is kept at least that long */
+         void set_max_age( uint32_t max_age_blocks )      { _max_age = max_age_blocks; }
+
+         /**
+          * Record the operations applied in block_num, assigning each the next operation sequence number.  Any history
+          * previously recorded for block_num or later blocks is discarded first.
+          */
+         void store_block( uint32_t block_num, vector<applied_operation>& ops );
+
+         /**
+          * @return up to limit operations from the history of account a, most recent first, starting with the most
+          * recent operation whose sequence is at most start (or the most recent operation if start is 0) and stopping
+          * before the first operation whose sequence is at most stop.
+          */
+         vector<operation_history_object> get_account_history( account_id_type a, uint64_t stop,
+                                                               uint32_t limit, uint64_t start )const;
+         /** @return the number of operations currently stored for account a */
+         uint64_t                         get_account_history_size( account_id_type a )const;
+         /** @return the sequence number the next applied operation will receive */
+         uint64_t                         get_next_sequence()const;
+
+      private:
+         void truncate( uint32_t block_num );
+         void remove_key( const history_key& k );
+         void prune_account( account_id_type a );
+
+         fc::path                                            _dbdir;
+         size_t                                              _cache_size = 0;
+         uint32_t                                            _max_ops_per_account = 0;
+         uint32_t                                            _max_age = 0;
+
+         bts::db::level_map<history_key, operation_history_object> _history;
+         bts::db::level_map<account_id_type, uint64_t>             _history_size;
+         bts::db::level_map<uint32_t, block_journal_entry>         _journal;
+   };
+
+} }
+
+FC_REFLECT( bts::chain::account_history_store::history_key, (account)(sequence) )
+FC_REFLECT( bts::chain::account_history_store::block_journal_entry, (next_sequence)(keys) )
@@ -21,19 +21,6 @@ namespace bts { namespace chain {
          static const uint8_t space_id = implementation_ids;
          static const uint8_t type_id  = impl_account_statistics_object_type;
 
-         /**
-          * Keep the most recent operation as a root pointer to
-          * a linked list of the transaction history. This field is
-          * not required by core validation and could in theory be
-          * made an annotation on the account object, but because
-          * transaction history is so common and this object is already
-          * cached in the undo buffer (because it likely affected the
-          * balances of this account) it is convienent to simply
-          * track this data here.  Account balance objects don't currenty
-          * inherit from annotated object.
-          */
-         account_transaction_history_id_type most_recent_op;
-
          /**
           *  When calculating votes it is necessary to know how much is
           *  stored in orders (and thus unavailable for transfers).  Rather
@@ -118,6 +105,8 @@ namespace bts { namespace chain {
          /// The owner authority contains the hot keys of the account. This authority has control over nearly all
          /// operations the account may perform.
          authority             active;
+         /// dynamic_global_property_object::authority_revision when owner or active last changed
+         uint32_t              authority_revision = 0;
 
          /// The memo key is the key this account will typically use to encrypt/sign transaction memos and other non-
          /// validated account activities. This field is here to prevent confusion if the active authority has zero or
@@ -238,7 +227,7 @@ namespace bts { namespace chain {
 }}
 FC_REFLECT_DERIVED( bts::chain::account_object,
                     (bts::db::annotated_object<bts::chain::account_object>),
-                    (registrar)(referrer)(referrer_percent)(name)(owner)(active)(memo_key)(voting_account)(num_witness)(num_committee)(votes)
+                    (registrar)(referrer)(referrer_percent)(name)(owner)(active)(authority_revision)(memo_key)(voting_account)(num_witness)(num_committee)(votes)
                     (statistics)(whitelisting_accounts)(blacklisting_accounts)(cashback_vb) )
 
 FC_REFLECT_DERIVED( bts::chain::account_balance_object,
@@ -250,7 +239,6 @@ FC_REFLECT_DERIVED( bts::chain::meta_account_object,
                     (memo_key)(delegate_id) )
 
 FC_REFLECT_DERIVED( bts::chain::account_statistics_object, (bts::chain::object),
-                    (most_recent_op)
                     (total_core_in_orders)
                     (lifetime_fees_paid)
                   )
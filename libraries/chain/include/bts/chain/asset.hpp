@@ -84,6 +84,8 @@ namespace bts { namespace chain {
       price min()const { return price::min( base.asset_id, quote.asset_id ); }
 
       double to_real()const { return double(base.amount.value)/double(quote.amount.value); }
+      /// @return a key which orders this price among the prices of its market, as stored by @ref sortable_price
+      uint64_t sort_key()const;
 
       bool is_null()const;
       void validate()const;
@@ -102,6 +104,32 @@ namespace bts { namespace chain {
    bool  operator != ( const price& a, const price& b );
    asset operator *  ( const asset& a, const price& b );
 
+   /**
+    *  @class sortable_price
+    *  @brief a price paired with its precomputed @ref price::sort_key, as the order books sort by
+    *
+    *  Comparing two prices cross multiplies their amounts in 128 bits, and the order books compare prices on every
+    *  insert, lookup and step of matching.  The sort key is the bit pattern of the price's ratio as a double, which
+    *  orders as the ratio does, and the division producing it rounds monotonically; so prices whose keys differ are
+    *  ordered by their keys alone, and only prices with equal keys are cross multiplied.  The order stays exact.
+    *
+    *  A price converts implicitly, computing its key, so that the order books can be searched by price.
+    */
+   struct sortable_price
+   {
+      sortable_price( const price& p ) : value(&p), key(p.sort_key()) {}
+      sortable_price( const price& p, uint64_t key ) : value(&p), key(key)
+      {
+         assert( key == p.sort_key() );
+      }
+
+      const price* value;
+      uint64_t     key;
+   };
+
+   bool  operator <  ( const sortable_price& a, const sortable_price& b );
+   inline bool operator > ( const sortable_price& a, const sortable_price& b ) { return b < a; }
+
    /**
     *  @class price_feed
     *  @brief defines market parameters for shorts and margin positions
@@ -219,25 +219,31 @@ namespace bts { namespace chain {
          /// Calculate the maximum force settlement volume per maintenance interval, given the current share supply
          share_type max_force_settlement_volume(share_type current_supply)const;
 
+         /// The time at which the oldest feed factored into current_feed expires, so the median must be recomputed
          time_point_sec feed_expiration_time()const
          { return current_feed_publication_time + options.feed_lifetime_sec; }
          bool feed_is_expired(time_point_sec current_time)const
-         { return feed_expiration_time() >= current_time; }
+         { return feed_expiration_time() <= current_time; }
          void update_median_feeds(time_point_sec current_time);
    };
 
 
    struct by_feed_expiration;
+   struct by_force_settled_volume;
    typedef multi_index_container<
       asset_bitasset_data_object,
       indexed_by<
          hashed_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
          ordered_non_unique< tag<by_feed_expiration>,
             const_mem_fun< asset_bitasset_data_object, time_point_sec, &asset_bitasset_data_object::feed_expiration_time >
+         >,
+         /// the bitassets force settled this maintenance interval are at the back
+         ordered_non_unique< tag<by_force_settled_volume>,
+            member< asset_bitasset_data_object, share_type, &asset_bitasset_data_object::force_settled_volume >
          >
       >
    > asset_bitasset_data_object_multi_index_type;
-   typedef flat_index<asset_bitasset_data_object> asset_bitasset_data_index;
+   typedef generic_index<asset_bitasset_data_object, asset_bitasset_data_object_multi_index_type> asset_bitasset_data_index;
 
    struct by_symbol;
    typedef multi_index_container<
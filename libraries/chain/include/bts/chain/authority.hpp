@@ -63,6 +63,11 @@ namespace bts { namespace chain {
          return result;
       }
 
+      bool operator==( const authority& other )const
+      {
+         return weight_threshold == other.weight_threshold && auths == other.auths;
+      }
+
       uint32_t                             weight_threshold = 0;
       flat_map<object_id_type,weight_type> auths;
    };
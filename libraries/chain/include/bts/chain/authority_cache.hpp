@@ -0,0 +1,50 @@
+#pragma once
+#include <bts/chain/authority.hpp>
+#include <bts/db/index.hpp>
+
+#include <map>
+#include <set>
+#include <unordered_set>
+
+namespace bts { namespace chain {
+
+   /**
+    * @class authority_cache
+    * @brief the account authorities found to be satisfied by a set of signing keys during the current block
+    *
+    * Resolving an authority walks a tree of accounts and keys.  Many transactions in a block are signed by the same
+    * keys for the same accounts, so each successful check is remembered along with the accounts whose authorities it
+    * read, and repeating it becomes a lookup.  Keys are named by id in authorities and signatures alike, so only the
+    * accounts determine the outcome.
+    *
+    * The cache observes the account index and forgets everything once one of the accounts read is added, modified or
+    * removed, whether by an evaluator or by undo.  The database also clears it at the start of each block.
+    */
+   class authority_cache : public bts::db::index_observer
+   {
+      public:
+         bool is_approved( account_id_type account, authority::classification auth_class,
+                           const vector<key_id_type>& signing_keys )const;
+         /**
+          * Records that signing_keys satisfy the auth_class authority of account
+          * @param accounts_read every account whose authority the check consulted, including account itself
+          */
+         void add_approval( account_id_type account, authority::classification auth_class,
+                            const vector<key_id_type>& signing_keys, const vector<account_id_type>& accounts_read );
+         void clear();
+         size_t size()const { return _approval_count; }
+
+         virtual void on_add( const object& obj )override    { on_change( obj.id ); }
+         virtual void on_modify( const object& obj )override { on_change( obj.id ); }
+         virtual void on_remove( const object& obj )override { on_change( obj.id ); }
+
+      private:
+         void on_change( object_id_type account );
+
+         /// the sorted signing key sets known to satisfy each account authority
+         std::map<std::pair<account_id_type, authority::classification>, std::set<vector<key_id_type>>> _approvals;
+         size_t                                                                                        _approval_count = 0;
+         std::unordered_set<object_id_type>                                                            _accounts_read;
+   };
+
+} } // bts::chain
@@ -35,6 +35,8 @@ namespace bts { namespace chain {
    struct signed_block : public signed_block_header
    {
       checksum_type calculate_merkle_root()const;
+      /// Calculate the merkle root from the merkle_digest() of each transaction, in block order
+      static checksum_type calculate_merkle_root( vector<digest_type> leaf_digests );
       vector<processed_transaction> transactions;
    };
 
@@ -0,0 +1,61 @@
+#pragma once
+#include <fstream>
+#include <bts/chain/block.hpp>
+
+namespace bts { namespace chain {
+
+   /**
+    * @class block_database
+    * @brief append-only log of the blocks on the current chain, indexed by block number
+    *
+    * Serialized blocks are appended to a data file, and the index file holds one fixed-width entry per block number
+    * (at offset (num-1) * sizeof(index_entry)) recording where that block lives in the data file.  Looking up a block
+    * by number is thus a single seek, and replaying the chain streams through both files in order.
+    *
+    * Only blocks on the current chain are tracked; blocks on competing forks live in the fork_database until they
+    * either become part of the chain or are discarded.
+    *
+    * Writes are buffered until @ref flush, which also forces both files onto the disk.  The database flushes before
+    * each checkpoint, so that the head block of a checkpointed object graph is always durable.  Entries whose blocks
+    * were lost in a crash are dropped when the log is opened, and each entry records the id of its block, which is
+    * checked whenever the block is read.
+    *
+    * This replaces the leveldb map from block id to block which nodes kept in database/block_num_to_block; see
+    * database::open for how such a store is migrated.
+    */
+   class block_database
+   {
+      public:
+         void open( const fc::path& dbdir );
+         bool is_open()const;
+         /// Writes out buffered blocks and waits until they are on disk
+         void flush();
+         void close();
+
+         void store( const block_id_type& id, const signed_block& b );
+         void remove( const block_id_type& id );
+
+         bool                   contains( const block_id_type& id )const;
+         block_id_type          fetch_block_id( uint32_t block_num )const;
+         optional<signed_block> fetch_optional( const block_id_type& id )const;
+         optional<signed_block> fetch_by_number( uint32_t block_num )const;
+         optional<signed_block> last()const;
+
+      private:
+         struct index_entry
+         {
+            uint64_t      block_pos  = 0;
+            uint32_t      block_size = 0; ///< 0 if there is no block with this number
+            block_id_type block_id;
+         };
+
+         void                   drop_torn_entries( const fc::path& dbdir );
+         optional<index_entry>  read_index_entry( uint32_t block_num )const;
+         signed_block           read_block( const index_entry& e )const;
+
+         fc::path             _dbdir;
+         mutable std::fstream _blocks;
+         mutable std::fstream _block_num_to_pos;
+   };
+
+} }
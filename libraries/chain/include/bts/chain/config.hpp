@@ -22,6 +22,8 @@
 #define BTS_DEFAULT_MAX_TIME_UNTIL_EXPIRATION (60*60*24) // seconds,  aka: 1 day
 #define BTS_DEFAULT_MAINTENANCE_INTERVAL  (60*60*24) // seconds, aka: 1 day
 #define BTS_DEFAULT_MAX_UNDO_HISTORY 1024
+#define BTS_MAX_UNLINKED_FORK_BLOCKS 1024 ///< blocks held by the fork database while waiting for their parents
+#define BTS_DEFAULT_CHECKPOINT_INTERVAL 1000 // blocks
 
 #define BTS_MIN_BLOCK_SIZE_LIMIT (BTS_MIN_TRANSACTION_SIZE_LIMIT*5) // 5 transactions per block
 #define BTS_MIN_TRANSACTION_EXPIRATION_LIMIT (BTS_MAX_BLOCK_INTERVAL * 5) // 5 transactions per block
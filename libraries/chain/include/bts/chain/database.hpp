@@ -5,6 +5,11 @@
 #include <bts/chain/global_property_object.hpp>
 #include <bts/chain/asset_object.hpp>
 #include <bts/chain/fork_database.hpp>
+#include <bts/chain/block_database.hpp>
+#include <bts/chain/account_history_store.hpp>
+#include <bts/chain/market_depth.hpp>
+#include <bts/chain/authority_cache.hpp>
+#include <bts/chain/transaction_object.hpp>
 
 #include <bts/db/object_database.hpp>
 #include <bts/db/object.hpp>
@@ -15,7 +20,13 @@
 
 #include <fc/log/logger.hpp>
 
+#include <deque>
+#include <functional>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fc { class thread; }
 
 namespace bts { namespace chain {
    using bts::db::abstract_object;
@@ -66,6 +77,17 @@ namespace bts { namespace chain {
          void wipe(const fc::path& data_dir, bool include_blocks);
          void close(uint32_t blocks_to_rewind = 0);
 
+         /**
+          * @brief Atomically persist the object graph as of the current head block
+          *
+          * Must only be called while the database is in a clean head block state, i.e. without pending transactions.
+          * After an unclean shutdown, @ref open restores the newest checkpoint and replays only the blocks after it.
+          */
+         void checkpoint();
+         /// Take a checkpoint every @ref blocks blocks while pushing blocks; 0 disables periodic checkpoints.
+         void set_checkpoint_interval( uint32_t blocks ) { _checkpoint_interval = blocks; }
+         uint32_t get_checkpoint_interval()const { return _checkpoint_interval; }
+
          /**
           *  @return true if the block is in our fork DB or saved to disk as
           *  part of the official chain, otherwise return false
@@ -75,6 +97,7 @@ namespace bts { namespace chain {
          block_id_type              get_block_id_for_num( uint32_t block_num )const;
          optional<signed_block>     fetch_block_by_id( const block_id_type& id )const;
          optional<signed_block>     fetch_block_by_number( uint32_t num )const;
+         /// @return a transaction pushed to this node with id trx_id, pending or applied, until it expires
          const signed_transaction&  get_recent_transaction( const transaction_id_type& trx_id )const;
 
          bool push_block( const signed_block& b, uint32_t skip = skip_nothing );
@@ -133,7 +156,12 @@ namespace bts { namespace chain {
             return;
          }
 
+         /**
+          *  Removes the head block.  Its transactions are set aside and revalidated as pending transactions the next
+          *  time a block is pushed.
+          */
          void pop_block();
+         /// Drops all pending transactions, including those set aside from popped blocks
          void clear_pending();
 
          /**
@@ -149,6 +177,24 @@ namespace bts { namespace chain {
          void      set_applied_operation_result( uint32_t op_id, const operation_result& r );
          const vector<operation_history_object>& get_applied_operations()const;
 
+         /**
+          *  The account history is not part of consensus state; it is only maintained when a plugin such as the
+          *  account_history_plugin provides a store for it, and is otherwise null.
+          */
+         void set_account_history_store( std::shared_ptr<account_history_store> store ) { _account_history = store; }
+         const account_history_store* get_account_history_store()const { return _account_history.get(); }
+
+         /**
+          *  Start maintaining the order books aggregated by price.  This costs a little for every order change, so it
+          *  is only done for nodes which serve depth queries.
+          */
+         void enable_market_depth() { _market_depth->enable( *this ); }
+         /** @return the aggregated order books, or null unless enable_market_depth() has been called */
+         const market_depth* get_market_depth()const { return _market_depth->enabled() ? _market_depth.get() : nullptr; }
+
+         /// Account authorities already checked against the signing keys of transactions in this block
+         authority_cache& get_authority_cache() { return *_authority_cache; }
+
          /**
           *  This signal is emitted after all operations and virtual operation for a
           *  block have been applied but before the get_applied_operations() are cleared.
@@ -207,6 +253,8 @@ namespace bts { namespace chain {
          /// @{ @group Market Helpers
          void globally_settle_asset( const asset_object& bitasset, const price& settle_price );
          void cancel_order( const limit_order_object& order, bool create_virtual_op = true );
+         /// Refunds the collateral of a short order which is cancelled by the chain, and removes it
+         void cancel_order( const short_order_object& order );
 
          /**
           * Matches the two orders,
@@ -241,6 +289,9 @@ namespace bts { namespace chain {
          bool convert_fees( const asset_object& mia );
          bool check_call_orders( const asset_object& mia );
 
+         /** public for testing purposes only; when set, check_call_orders always scans the order books */
+         bool _disable_call_check_cache = false;
+
          // helpers to fill_order
          void pay_order( const account_object& receiver, const asset& receives, const asset& pays );
          asset pay_market_fees( const asset_object& recv_asset, const asset& receives );
@@ -270,8 +321,23 @@ namespace bts { namespace chain {
          template<class ObjectType>
          vector<std::reference_wrapper<const ObjectType>> sort_votable_objects(size_t count)const;
 
+         bool                  match_call_orders( const asset_object& mia, const asset_bitasset_data_object& bitasset );
+         void                  update_call_check_cache( const asset_object& mia );
+
+         bool                  _push_block( const signed_block& new_block, uint32_t skip );
+         /// Re-push the transactions of popped blocks followed by old_pending, dropping any no longer valid
+         void                  restore_pending_transactions( vector<processed_transaction> old_pending );
          void                  apply_block( const signed_block& next_block, uint32_t skip = skip_nothing );
+         /// Same as b.calculate_merkle_root(), but large blocks have their transactions hashed on the worker threads
+         checksum_type         calculate_merkle_root( const signed_block& b )const;
+         /// Call work(i) for every i below count on the worker threads, each i on exactly one thread, and wait without
+         /// yielding to other tasks on the calling thread
+         void                  run_in_parallel( size_t count, const std::function<void(size_t)>& work )const;
          processed_transaction apply_transaction( const signed_transaction& trx, uint32_t skip = skip_nothing );
+         /// Apply the stored blocks which link onto the head block, used to catch up after restoring a checkpoint
+         /// Copies the current chain out of the leveldb block store kept by older versions into the block log
+         void                  migrate_legacy_block_store( const fc::path& legacy_dir );
+         void                  replay_blocks_after_head();
          operation_result      apply_operation( transaction_evaluation_state& eval_state, const operation& op );
 
          ///Steps involved in applying a new block
@@ -294,11 +360,35 @@ namespace bts { namespace chain {
          void clear_expired_transactions();
          void clear_expired_proposals();
          void clear_expired_orders();
+         void execute_force_settlements( const asset_object& mia_object );
          void update_expired_feeds();
          void update_withdraw_permissions();
          ///@}
 
          signed_block                           _pending_block;
+         /// merkle_digest() of each of _pending_block's transactions, taken as they are pushed
+         vector<digest_type>                    _pending_merkle_digests;
+         /**
+          * Transactions pushed to this node, kept by id until they expire so that peers can fetch them while
+          * they are pending and after they are included in a block. This is not part of the chain state and is
+          * not affected by undo.
+          */
+         struct recent_transaction
+         {
+            transaction_id_type trx_id;
+            time_point_sec      expiration;
+            signed_transaction  trx;
+         };
+         typedef multi_index_container<
+            recent_transaction,
+            indexed_by<
+               hashed_unique< tag<by_trx_id>, BOOST_MULTI_INDEX_MEMBER(recent_transaction, transaction_id_type, trx_id), std::hash<transaction_id_type> >,
+               ordered_non_unique< tag<by_expiration>, BOOST_MULTI_INDEX_MEMBER(recent_transaction, time_point_sec, expiration) >
+            >
+         > recent_transaction_index;
+         recent_transaction_index               _recent_transactions;
+         /// Transactions of popped blocks, oldest first, waiting to be re-pushed once the new head is applied
+         std::deque<signed_transaction>         _popped_tx;
          fork_database                          _fork_db;
 
          /**
@@ -310,7 +400,7 @@ namespace bts { namespace chain {
           *  until the fork is resolved.  This should make maintaining
           *  the fork tree relatively simple.
           */
-         bts::db::level_map<block_id_type, signed_block>   _block_id_to_block;
+         block_database                                    _block_id_to_block;
 
          /**
           * Contains the set of ops that are in the process of being applied from
@@ -320,15 +410,82 @@ namespace bts { namespace chain {
           */
          vector<operation_history_object>  _applied_ops;
 
+         std::shared_ptr<account_history_store> _account_history;
+         /// registered as an observer of the order indexes, but idle until enable_market_depth()
+         std::shared_ptr<market_depth>          _market_depth;
+         /// registered as an observer of the account index
+         std::shared_ptr<authority_cache>       _authority_cache;
+
+         uint32_t                          _checkpoint_interval  = BTS_DEFAULT_CHECKPOINT_INTERVAL;
+         uint32_t                          _last_checkpoint_num  = 0;
+
          uint32_t                          _current_block_num    = 0;
          uint16_t                          _current_trx_in_block = 0;
          uint16_t                          _current_op_in_trx    = 0;
          uint16_t                          _current_virtual_op   = 0;
 
+         /**
+          * The front of the book in a market where check_call_orders last found nothing to do.  Order changes which
+          * leave the top ask above the call trigger cannot cause a margin call, so those markets are not rescanned.
+          * The cache is derived from the order indexes, which keep it current through call_check_observer.
+          */
+         struct call_check_state
+         {
+            asset_id_type            backing_asset;
+            price                    call_limit;   ///< lowest ask price allowed to fill calls
+            optional<object_id_type> top_order;    ///< limit or short order at the front of the book
+            price                    top_price;
+            optional<price>          call_trigger; ///< inverted call price of the least collateralized call
+         };
+         class call_check_observer;
+         flat_map<asset_id_type, call_check_state> _call_check_cache;
+
+         /// Worker threads used by run_in_parallel(), created on first use
+         mutable vector<std::shared_ptr<fc::thread>> _worker_threads;
+
          vector<uint64_t>                  _vote_tally_buffer;
          vector<uint64_t>                  _witness_count_histogram_buffer;
          vector<uint64_t>                  _committee_count_histogram_buffer;
          uint64_t                          _total_voting_stake;
+
+         /**
+          * Running vote aggregates, so that maintenance need not visit every account.  vote_tally_observer marks the
+          * accounts whose voting stake or opinions may have changed, and update_vote_totals() folds only those into
+          * the aggregates.  Nothing here is persisted; the aggregates are rebuilt from every account after opening.
+          */
+         struct voter_stake
+         {
+            account_id_type              opinion_account;
+            uint64_t                     stake = 0;
+         };
+         /// The opinions of an account, as last applied to the tallies, and the stake voting with them
+         struct opinion_tally
+         {
+            uint64_t                     delegated_stake = 0;
+            flat_set<vote_id_type>       votes;
+            uint16_t                     num_witness = 0;
+            uint16_t                     num_committee = 0;
+         };
+         class vote_tally_observer;
+
+         void reset_vote_tallies();
+         void tally_account( account_id_type account_id, bool count_non_prime_votes );
+         /// adds delta (modulo 2^64, so it may be a negated amount) to everything opinion votes for
+         void tally_opinion( const opinion_tally& opinion, uint64_t delta );
+
+         bool                                                _vote_tallies_valid = false;
+         bool                                                _tallied_non_prime_votes = false;
+         std::unordered_set<object_id_type>                  _dirty_voters;
+         /// statistics object id -> owning account, as statistics objects do not refer back to their account
+         std::unordered_map<object_id_type, account_id_type> _statistics_owners;
+         std::unordered_map<object_id_type, voter_stake>     _voter_stakes;
+         std::unordered_map<object_id_type, opinion_tally>   _opinion_tallies;
+         vector<uint64_t>                                    _vote_tallies;
+         /// votes for ids at or past next_available_vote_id when they were tallied
+         std::unordered_map<uint32_t, uint64_t>              _overflow_vote_tallies;
+         flat_map<uint16_t, uint64_t>                        _witness_count_stake;
+         flat_map<uint16_t, uint64_t>                        _committee_count_stake;
+         uint64_t                                            _tallied_voting_stake = 0;
    };
 
    template<class Content>
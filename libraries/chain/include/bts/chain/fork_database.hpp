@@ -4,6 +4,7 @@
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
+#include <boost/multi_index/mem_fun.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 
@@ -16,6 +17,8 @@ namespace bts { namespace chain {
       fork_item( signed_block d )
       :num(d.block_num()),id(d.id()),data( std::move(d) ){}
 
+      block_id_type previous_id()const { return data.previous; }
+
       weak_ptr< fork_item > prev;
       uint32_t              num;
       /**
@@ -37,6 +40,12 @@ namespace bts { namespace chain {
     *
     *  Every time a block is pushed into the fork DB the
     *  block with the highest block_num will be returned.
+    *
+    *  A block whose previous block is not yet known is held
+    *  (up to BTS_MAX_UNLINKED_FORK_BLOCKS of them) rather than
+    *  discarded, and push_block throws unlinkable_block.  When
+    *  the missing block arrives, every held block that builds
+    *  on it is linked into the tree as well, parents first.
     */
    class fork_database
    {
@@ -52,7 +61,12 @@ namespace bts { namespace chain {
          bool                             is_known_block( const block_id_type& id )const;
          shared_ptr<fork_item>            fetch_block( const block_id_type& id )const;
          vector<item_ptr>                 fetch_block_by_number( uint32_t n )const;
+         /**
+          *  @throws unlinkable_block if b's previous block is not known yet; b is held until it is
+          */
          shared_ptr<fork_item>            push_block( signed_block b );
+         /** @return true if id is held waiting for its previous block */
+         bool                             is_unlinked_block( const block_id_type& id )const;
          shared_ptr<fork_item>            head()const { return _head; }
          void                             pop_block();
 
@@ -74,8 +88,24 @@ namespace bts { namespace chain {
             >
          > fork_multi_index_type;
 
+         struct by_previous{};
+         typedef multi_index_container<
+            item_ptr,
+            indexed_by<
+               hashed_unique< tag<block_id>, member< fork_item, block_id_type, &fork_item::id>, std::hash<fc::ripemd160> >,
+               hashed_non_unique< tag<by_previous>, const_mem_fun< fork_item, block_id_type, &fork_item::previous_id >,
+                                  std::hash<fc::ripemd160> >,
+               ordered_non_unique< tag<block_num>, member<fork_item,uint32_t,&fork_item::num> >
+            >
+         > unlinked_multi_index_type;
+
       private:
-         fork_multi_index_type    _index;
-         shared_ptr<fork_item>    _head;
+         void                     _push_block( const item_ptr& item );
+         void                     _push_next( const item_ptr& new_item );
+         void                     _hold_unlinked( const item_ptr& item );
+
+         fork_multi_index_type     _index;
+         unlinked_multi_index_type _unlinked_index;
+         shared_ptr<fork_item>     _head;
    };
 } } // bts::chain
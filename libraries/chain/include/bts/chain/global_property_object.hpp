@@ -58,6 +58,10 @@ namespace bts { namespace chain {
          time_point_sec    next_maintenance_time;
          time_point_sec    last_budget_time;
          share_type        witness_budget;
+         /// Incremented whenever the owner or active authority of any account changes; the account records the new
+         /// value as its own authority_revision, so that what was derived from its authorities can tell when it must
+         /// be derived again
+         uint32_t          authority_revision = 0;
    };
 }}
 
@@ -70,6 +74,7 @@ FC_REFLECT_DERIVED( bts::chain::dynamic_global_property_object, (bts::db::object
                     (current_witness)
                     (next_maintenance_time)
                     (witness_budget)
+                    (authority_revision)
                   )
 
 FC_REFLECT_DERIVED( bts::chain::global_property_object, (bts::db::object),
@@ -26,9 +26,13 @@ namespace bts { namespace chain {
         account_id_type  seller;
         share_type       for_sale; ///< asset id is sell_price.base.asset_id
         price            sell_price;
+        uint64_t         sell_price_key = 0; ///< sell_price.sort_key(), kept by set_sell_price()
 
         asset amount_for_sale()const   { return asset( for_sale, sell_price.base.asset_id ); }
         asset amount_to_receive()const { return amount_for_sale() * sell_price; }
+
+        void set_sell_price( const price& p ) { sell_price = p; sell_price_key = p.sort_key(); }
+        sortable_price sortable_sell_price()const { return sortable_price( sell_price, sell_price_key ); }
   };
 
   struct by_id;
@@ -42,10 +46,10 @@ namespace bts { namespace chain {
         ordered_non_unique< tag<by_expiration>, member< limit_order_object, time_point_sec, &limit_order_object::expiration> >,
         ordered_unique< tag<by_price>,
            composite_key< limit_order_object,
-              member< limit_order_object, price, &limit_order_object::sell_price>,
+              const_mem_fun< limit_order_object, sortable_price, &limit_order_object::sortable_sell_price>,
               member< object, object_id_type, &object::id>
            >,
-           composite_key_compare< std::greater<price>, std::less<object_id_type> >
+           composite_key_compare< std::greater<sortable_price>, std::less<object_id_type> >
         >
      >
   > limit_order_multi_index_type;
@@ -56,6 +60,6 @@ namespace bts { namespace chain {
 
 FC_REFLECT_DERIVED( bts::chain::limit_order_object,
                     (bts::db::object),
-                    (expiration)(seller)(for_sale)(sell_price)
+                    (expiration)(seller)(for_sale)(sell_price)(sell_price_key)
                   )
 
@@ -0,0 +1,107 @@
+#pragma once
+#include <bts/chain/asset.hpp>
+#include <bts/db/index.hpp>
+
+#include <map>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+
+namespace bts { namespace chain {
+   class database;
+
+   /** The kinds of order aggregated by market_depth */
+   enum depth_order_type
+   {
+      limit_depth,
+      short_depth,
+      call_depth    ///< margin positions, which offer their collateral for their debt at the call price
+   };
+
+   /**
+    * The total of the orders of one kind offering sell_price.base for sell_price.quote at one price.  A level with an
+    * order_count of 0 has been emptied; it only appears in the changes reported by market_depth::get_changed_levels().
+    */
+   struct price_level
+   {
+      depth_order_type order_type = limit_depth;
+      price            sell_price;
+      share_type       for_sale;        ///< in sell_price.base; the collateral of call orders
+      uint32_t         order_count = 0;
+   };
+
+   /**
+    * @class market_depth
+    * @brief the orders of every market aggregated by price, maintained from the order index observers
+    *
+    * Order books are kept per order type and direction, so a depth query costs time proportional to the number of
+    * price levels returned rather than the number of orders in the book.  The levels changed since clear_changes()
+    * are tracked so that subscribers can be sent only what moved.
+    *
+    * Nothing is maintained until enable() is called, and nothing is persisted; after the indexes are loaded from disk
+    * the levels are rebuilt from every order.
+    */
+   class market_depth : public bts::db::index_observer
+   {
+      public:
+         bool enabled()const { return _enabled; }
+         void enable( const database& db );
+         /** aggregate every order in db from scratch, discarding whatever was maintained before */
+         void rebuild( const database& db );
+
+         /**
+          * @return up to limit levels of the orders of type offering base for quote, best first: the highest sell price
+          * for limit and short orders, and the lowest call price (the first to be called) for call orders
+          */
+         vector<price_level> get_levels( depth_order_type type, asset_id_type base, asset_id_type quote,
+                                         uint32_t limit )const;
+
+         /** @return the current state of every level changed since clear_changes(), including emptied ones */
+         vector<price_level> get_changed_levels()const;
+         void                clear_changes() { _changed_levels.clear(); }
+
+         virtual void on_add( const object& obj )override;
+         virtual void on_modify( const object& obj )override;
+         virtual void on_remove( const object& obj )override;
+
+      private:
+         struct book_key
+         {
+            depth_order_type order_type;
+            asset_id_type    base;
+            asset_id_type    quote;
+
+            friend bool operator < ( const book_key& a, const book_key& b )
+            {
+               return std::tie( a.order_type, a.base, a.quote ) < std::tie( b.order_type, b.base, b.quote );
+            }
+         };
+         struct level_totals
+         {
+            share_type for_sale;
+            uint32_t   order_count = 0;
+         };
+         /** what an order last contributed, as on_modify and on_remove only see its new value */
+         struct order_entry
+         {
+            book_key   book;
+            price      sell_price;
+            share_type for_sale;
+         };
+         /** levels in ascending price order; prices within a book all have the same assets */
+         typedef std::map<price, level_totals> book_levels;
+
+         void add_order( const object& obj );
+         void remove_order( object_id_type id );
+         price_level make_level( const book_key& book, const price& p, const level_totals* totals )const;
+
+         bool                                              _enabled = false;
+         std::map<book_key, book_levels>                   _books;
+         std::unordered_map<object_id_type, order_entry>   _orders;
+         std::set<std::pair<book_key, price>>              _changed_levels;
+   };
+
+} } // bts::chain
+
+FC_REFLECT_ENUM( bts::chain::depth_order_type, (limit_depth)(short_depth)(call_depth) )
+FC_REFLECT( bts::chain::price_level, (order_type)(sell_price)(for_sale)(order_count) )
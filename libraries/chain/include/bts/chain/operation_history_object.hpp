@@ -38,40 +38,7 @@ namespace bts { namespace chain {
          /** any virtual operations implied by operation in block */
          uint16_t          virtual_op = 0;
    };
-
-   /**
-    *  @brief a node in a linked list of operation_history_objects
-    *  @ingroup implementation
-    *  @ingroup object
-    *
-    *  Account history is important for users and wallets even though it is
-    *  not part of "core validation".   Account history is maintained as
-    *  a linked list stored on disk in a stack.  Each account will point to the
-    *  most recent account history object by ID.  When a new operation relativent
-    *  to that account is processed a new account history object is allcoated at
-    *  the end of the stack and intialized to point to the prior object.
-    *
-    *  This data is never accessed as part of chain validation and therefore
-    *  can be kept on disk as a memory mapped file.  Using a memory mapped file
-    *  will help the operating system better manage / cache / page files and
-    *  also accelerates load time.
-    *
-    *  When the transaction history for a particular account is requested the
-    *  linked list can be traversed with relatively effecient disk access because
-    *  of the use of a memory mapped stack.
-    */
-   class account_transaction_history_object :  public abstract_object<account_transaction_history_object>
-   {
-      public:
-         static const uint8_t space_id = implementation_ids;
-         static const uint8_t type_id  = impl_account_transaction_history_object_type;
-         operation_history_id_type            operation_id;
-         account_transaction_history_id_type  next;
-   };
 } } // bts::chain
 
 FC_REFLECT_DERIVED( bts::chain::operation_history_object, (bts::chain::object),
                     (op)(result)(block_num)(trx_in_block)(op_in_trx)(virtual_op) )
-
-FC_REFLECT_DERIVED( bts::chain::account_transaction_history_object, (bts::chain::object),
-                    (operation_id)(next) )
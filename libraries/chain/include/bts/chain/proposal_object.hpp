@@ -9,6 +9,35 @@
 namespace bts { namespace chain {
 
 
+/**
+ *  @brief the approvals of a proposal counted toward one of the authorities it requires
+ *
+ *  The keys and accounts named in the authority are counted directly.  The authority is satisfied once their approved
+ *  weight reaches its threshold, and cannot be while the approved and unapproved account weights together fall short
+ *  of it.  In between, the accounts which have not approved may still be satisfied by their own authorities, but only
+ *  if something in those has approved or one of them needs no approvals at all; only then must the authority be walked.
+ *
+ *  A tally stays valid until the authority of its account, or of an account in nested_members, changes.  Keeping
+ *  nested_members in the proposal makes it as large as the authorities it requires, and every update of the proposal
+ *  copies it for undo, so an update costs O(size of the required authorities) rather than O(changed approvals).
+ */
+struct approval_tally
+{
+   /// dynamic_global_property_object::authority_revision when the authority was last counted in full; the tally is
+   /// stale once the account or an account in nested_members has a later account_object::authority_revision
+   uint32_t                 authority_revision = 0;
+   /// weight of the keys and accounts in the authority which have approved the proposal
+   uint32_t                 approved_weight = 0;
+   /// weight of the accounts in the authority which have not approved the proposal themselves
+   uint32_t                 unapproved_account_weight = 0;
+   /// the keys and accounts in the authorities of the accounts in the authority, as deep as check_authority follows
+   flat_set<object_id_type> nested_members;
+   /// how many of nested_members have approved the proposal
+   uint32_t                 nested_approvals = 0;
+   /// whether an account check_authority follows has a zero threshold, and so may be satisfied without any approvals
+   bool                     nested_zero_threshold = false;
+};
+
 /**
  *  @brief tracks the approval of a partially approved transaction 
  *  @ingroup object
@@ -28,8 +57,28 @@ class proposal_object : public abstract_object<proposal_object>
       flat_set<account_id_type>     required_owner_approvals;
       flat_set<account_id_type>     available_owner_approvals;
       flat_set<key_id_type>         available_key_approvals;
+      /// The available approvals counted toward each required authority, kept up to date by update_approval_tallies()
+      flat_map<account_id_type, approval_tally> active_approval_tallies;
+      flat_map<account_id_type, approval_tally> owner_approval_tallies;
 
       bool is_authorized_to_execute(database* db)const;
+
+      /**
+       * Brings the tallies up to date after approvals are added or removed, counting only the given changes unless the
+       * required account's authority or that of an account nested in it has changed since they were last counted.
+       *
+       * @param added approvals which have just been added, as accounts with the authority they approve with, or keys
+       * @param removed approvals which have just been removed, likewise
+       */
+      void update_approval_tallies( const database& db,
+                                    const vector<pair<object_id_type, authority::classification>>& added,
+                                    const vector<pair<object_id_type, authority::classification>>& removed );
+      /// Counts the available approvals toward every required authority from scratch
+      void count_approval_tallies( const database& db );
+
+   private:
+      approval_tally count_approvals( const database& db, const account_object& account,
+                                      authority::classification auth_class )const;
 };
 
 struct by_expiration{};
@@ -44,7 +93,9 @@ typedef generic_index<proposal_object, proposal_multi_index_container> proposal_
 
 } } // bts::chain
 
+FC_REFLECT( bts::chain::approval_tally,
+            (authority_revision)(approved_weight)(unapproved_account_weight)(nested_members)(nested_approvals)(nested_zero_threshold) )
 FC_REFLECT_DERIVED( bts::chain::proposal_object, (bts::chain::object),
                     (expiration_time)(review_period_time)(proposed_transaction)(required_active_approvals)
                     (available_active_approvals)(required_owner_approvals)(available_owner_approvals)
-                    (available_key_approvals) )
+                    (available_key_approvals)(active_approval_tallies)(owner_approval_tallies) )
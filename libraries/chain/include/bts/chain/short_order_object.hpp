@@ -38,6 +38,7 @@ namespace bts { namespace chain {
         share_type       for_sale;
         share_type       available_collateral; ///< asset_id == sell_price.quote.asset_id
         price            sell_price; ///< the price the short is currently at = min(limit_price,feed)
+        uint64_t         sell_price_key = 0; ///< sell_price.sort_key(), kept by set_sell_price()
         price            call_price; ///< the price that will be used to trigger margin calls after match, must be 1:1 if prediction market
         uint16_t         initial_collateral_ratio    = 0; ///< may be higher than the network requires
         uint16_t         maintenance_collateral_ratio = 0; ///< may optionally be higher than the network requires
@@ -48,6 +49,9 @@ namespace bts { namespace chain {
          */
         asset amount_for_sale()const   { return asset( for_sale, sell_price.base.asset_id ); }
         asset amount_to_receive()const { return amount_for_sale() * sell_price; }
+
+        void set_sell_price( const price& p ) { sell_price = p; sell_price_key = p.sort_key(); }
+        sortable_price sortable_sell_price()const { return sortable_price( sell_price, sell_price_key ); }
   };
 
   /**
@@ -69,12 +73,18 @@ namespace bts { namespace chain {
         asset_id_type debt_type()const { return call_price.quote.asset_id; }
         price collateralization()const { return get_collateral() / get_debt(); }
 
-        void update_call_price() { call_price = price::call_price(get_debt(), get_collateral(), maintenance_collateral_ratio); }
+        void update_call_price()
+        {
+           call_price = price::call_price(get_debt(), get_collateral(), maintenance_collateral_ratio);
+           call_price_key = call_price.sort_key();
+        }
+        sortable_price sortable_call_price()const { return sortable_price( call_price, call_price_key ); }
 
         account_id_type  borrower;
         share_type       collateral;  ///< call_price.base.asset_id, access via get_collateral
         share_type       debt;        ///< call_price.quote.asset_id, access via get_collateral
         price            call_price;
+        uint64_t         call_price_key = 0; ///< call_price.sort_key(), kept by update_call_price()
         uint16_t         maintenance_collateral_ratio;
   };
 
@@ -111,10 +121,10 @@ namespace bts { namespace chain {
         ordered_non_unique< tag<by_expiration>, member< short_order_object, time_point_sec, &short_order_object::expiration> >,
         ordered_unique< tag<by_price>,
            composite_key< short_order_object,
-              member< short_order_object, price, &short_order_object::sell_price>,
+              const_mem_fun< short_order_object, sortable_price, &short_order_object::sortable_sell_price>,
               member< object, object_id_type, &object::id>
            >,
-           composite_key_compare< std::greater<price>, std::less<object_id_type> >
+           composite_key_compare< std::greater<sortable_price>, std::less<object_id_type> >
         >
      >
   > short_order_multi_index_type;
@@ -126,10 +136,10 @@ namespace bts { namespace chain {
             member< object, object_id_type, &object::id > >,
          ordered_unique< tag<by_price>,
             composite_key< call_order_object,
-               member< call_order_object, price, &call_order_object::call_price>,
+               const_mem_fun< call_order_object, sortable_price, &call_order_object::sortable_call_price>,
                member< object, object_id_type, &object::id>
             >,
-            composite_key_compare< std::less<price>, std::less<object_id_type> >
+            composite_key_compare< std::less<sortable_price>, std::less<object_id_type> >
          >,
          ordered_unique< tag<by_account>,
             composite_key< call_order_object,
@@ -171,11 +181,11 @@ namespace bts { namespace chain {
 } } // bts::chain
 
 FC_REFLECT_DERIVED( bts::chain::short_order_object, (bts::db::object),
-                    (expiration)(seller)(for_sale)(available_collateral)(sell_price)
+                    (expiration)(seller)(for_sale)(available_collateral)(sell_price)(sell_price_key)
                     (call_price)(initial_collateral_ratio)(maintenance_collateral_ratio)
                   )
 
 FC_REFLECT_DERIVED( bts::chain::call_order_object, (bts::db::object),
-                    (borrower)(collateral)(debt)(call_price)(maintenance_collateral_ratio) )
+                    (borrower)(collateral)(debt)(call_price)(call_price_key)(maintenance_collateral_ratio) )
 
 FC_REFLECT( bts::chain::force_settlement_object, (owner)(balance)(settlement_date) )
@@ -114,6 +114,31 @@ namespace bts { namespace chain {
       optional<block_id_type> block_id_cache;
    };
 
+   /**
+    *  @brief the id and digests of a transaction, computed from a single serialization of it
+    *
+    *  Each of transaction::id(), digest() and digest(ref_block_id) serializes and hashes the whole transaction.  Code
+    *  which needs several of them for a transaction that will not change while it is being used, such as
+    *  database::apply_transaction, should take them from here instead.  The id and the absolute expiration digest
+    *  are the same hash, so that hash is only computed once.
+    */
+   class transaction_digests
+   {
+      public:
+         explicit transaction_digests( const transaction& trx );
+
+         const transaction_id_type& id()const { return _id; }
+         /// Same as transaction::digest(); only meaningful for transactions with an absolute expiration time
+         const digest_type&         digest()const { return _digest; }
+         /// Same as transaction::digest(ref_block_id)
+         digest_type                digest( const block_id_type& ref_block_id )const;
+
+      private:
+         vector<char>        _packed;
+         digest_type         _digest;
+         transaction_id_type _id;
+   };
+
    /**
     *  @brief adds a signature to a transaction
     */
@@ -125,8 +150,22 @@ namespace bts { namespace chain {
       void sign( key_id_type id, const private_key_type& key );
       flat_map<key_id_type,signature_type> signatures;
 
+      /**
+       * @return the address of the key which produced each signature, recovered against trx_digest
+       *
+       * Public key recovery is the most expensive part of validating a transaction, so the recovered addresses are
+       * cached in the transaction (and in its copies) until the digest or the signatures change. This method is safe
+       * to call from a worker thread as long as no other thread accesses the same transaction.
+       */
+      flat_map<key_id_type,address> get_signature_addresses( const digest_type& trx_digest )const;
+
       /// Removes all operations and signatures
-      void clear() { operations.clear(); signatures.clear(); }
+      void clear() { operations.clear(); signatures.clear(); signature_cache.clear(); }
+
+   private:
+      // Intentionally unreflected: does not go on wire
+      mutable digest_type                                          signature_cache_digest;
+      mutable flat_map<key_id_type,pair<signature_type,address>>   signature_cache;
    };
 
    /**
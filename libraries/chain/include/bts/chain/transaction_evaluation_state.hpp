@@ -40,5 +40,14 @@ namespace bts { namespace chain {
          database*                 _db = nullptr;
          bool                      _skip_authority_check = false;
          bool                      _is_proposed_trx = false;
+
+      private:
+         /// walks the authority tree of account, which check_authority has found neither approved nor cached
+         bool resolve_authority( const account_object& account, authority::classification auth_class, int depth );
+
+         /// the ids of the keys which signed _trx, sorted, as the authority cache knows them
+         vector<key_id_type>       _signing_keys;
+         /// while resolving an authority for the cache, the accounts whose authorities were consulted
+         vector<account_id_type>*  _accounts_read = nullptr;
    };
 } } // namespace bts::chain
@@ -23,6 +23,9 @@ namespace bts { namespace chain {
     *  added.  At the end of block processing all
     *  transaction_objects that have expired can
     *  be removed from the index.
+    *
+    *  Only the id and expiration are kept; the transaction
+    *  itself is in the block that included it.
     */
    class transaction_object : public abstract_object<transaction_object>
    {
@@ -30,7 +33,6 @@ namespace bts { namespace chain {
          static const uint8_t space_id = implementation_ids;
          static const uint8_t type_id  = impl_transaction_object_type;
 
-         signed_transaction  trx;
          time_point_sec      expiration;
          transaction_id_type trx_id;
    };
@@ -52,4 +54,4 @@ namespace bts { namespace chain {
 
 } }
 
-FC_REFLECT_DERIVED( bts::chain::transaction_object, (bts::db::object), (trx)(expiration) )
+FC_REFLECT_DERIVED( bts::chain::transaction_object, (bts::db::object), (expiration)(trx_id) )
@@ -46,14 +46,12 @@ object_id_type limit_order_create_evaluator::do_apply( const limit_order_create_
    const auto& new_order_object = db().create<limit_order_object>( [&]( limit_order_object& obj ){
        obj.seller   = _seller->id;
        obj.for_sale = op.amount_to_sell.amount;
-       obj.sell_price = op.get_price();
+       obj.set_sell_price( op.get_price() );
        obj.expiration = op.expiration;
    });
    limit_order_id_type result = new_order_object.id; // save this because we may remove the object by filling it
 
-   // Possible optimization: We only need to check calls if both are true:
-   //  - The new order is at the front of the book
-   //  - The new order is below the call limit price
+   // check_call_orders returns immediately unless the new order crossed the call trigger at the front of the book
    bool called_some = db().check_call_orders(*_sell_asset);
    called_some |= db().check_call_orders(*_receive_asset);
    if( called_some && !db().find(result) ) // then we were filled by call order
@@ -62,19 +60,14 @@ object_id_type limit_order_create_evaluator::do_apply( const limit_order_create_
    const auto& limit_order_idx = db().get_index_type<limit_order_index>();
    const auto& limit_price_idx = limit_order_idx.indices().get<by_price>();
 
-   // TODO: it should be possible to simply check the NEXT/PREV iterator after new_order_object to
-   // determine whether or not this order has "changed the book" in a way that requires us to
-   // check orders.   For now I just lookup the lower bound and check for equality... this is log(n) vs
-   // constant time check. Potential optimization.
-
+   // The book is sorted best price first, so the orders crossed by the new one are those at the front of the opposite
+   // market; each is recognized by comparing it to the new order's price rather than looking up where the range ends.
    auto max_price  = ~op.get_price(); //op.min_to_receive / op.amount_to_sell;
+   auto crosses = [&]( const price& sell_price ) { return sell_price >= max_price; };
    auto limit_itr = limit_price_idx.lower_bound( max_price.max() );
-   auto limit_end = limit_price_idx.upper_bound( max_price );
-
-   for( auto tmp = limit_itr; tmp != limit_end; ++tmp )
-   {
-      assert( tmp != limit_price_idx.end() );
-   }
+   auto limit_end = limit_price_idx.end();
+   if( limit_itr != limit_end && !crosses( limit_itr->sell_price ) )
+      limit_itr = limit_end;
 
    bool filled = false;
    //if( new_order_object.amount_to_receive().asset_id(db()).is_market_issued() )
@@ -90,9 +83,10 @@ object_id_type limit_order_create_evaluator::do_apply( const limit_order_create_
       const auto& short_order_idx = db().get_index_type<short_order_index>();
       const auto& sell_price_idx = short_order_idx.indices().get<by_price>();
 
-      FC_ASSERT( max_price.max() >= max_price );
       auto short_itr = sell_price_idx.lower_bound( max_price.max() );
-      auto short_end = sell_price_idx.upper_bound( max_price );
+      auto short_end = sell_price_idx.end();
+      if( short_itr != short_end && !crosses( short_itr->sell_price ) )
+         short_itr = short_end;
 
       while( !filled )
       {
@@ -101,20 +95,23 @@ object_id_type limit_order_create_evaluator::do_apply( const limit_order_create_
             if( short_itr != short_end && limit_itr->sell_price < short_itr->sell_price )
             {
                auto old_short_itr = short_itr;
-               ++short_itr;
+               if( ++short_itr != short_end && !crosses( short_itr->sell_price ) )
+                  short_itr = short_end;
                filled = (db().match( new_order_object, *old_short_itr, old_short_itr->sell_price ) != 2 );
             }
             else
             {
                auto old_limit_itr = limit_itr;
-               ++limit_itr;
+               if( ++limit_itr != limit_end && !crosses( limit_itr->sell_price ) )
+                  limit_itr = limit_end;
                filled = (db().match( new_order_object, *old_limit_itr, old_limit_itr->sell_price ) != 2 );
             }
          }
          else if( short_itr != short_end  )
          {
             auto old_short_itr = short_itr;
-            ++short_itr;
+            if( ++short_itr != short_end && !crosses( short_itr->sell_price ) )
+               short_itr = short_end;
             filled = (db().match( new_order_object, *old_short_itr, old_short_itr->sell_price ) != 2 );
          }
          else break;
@@ -123,7 +120,8 @@ object_id_type limit_order_create_evaluator::do_apply( const limit_order_create_
    else while( !filled && limit_itr != limit_end  )
    {
          auto old_itr = limit_itr;
-         ++limit_itr;
+         if( ++limit_itr != limit_end && !crosses( limit_itr->sell_price ) )
+            limit_itr = limit_end;
          filled = (db().match( new_order_object, *old_itr, old_itr->sell_price ) != 2);
    }
 
@@ -159,8 +157,7 @@ asset limit_order_cancel_evaluator::do_apply( const limit_order_cancel_operation
 
    db().cancel_order( *_order, false /* don't create a virtual op*/ );
 
-   // Possible optimization: order can be called by canceling a limit order iff the canceled order was at the top of the book.
-   // Do I need to check calls in both assets?
+   // check_call_orders returns immediately unless the canceled order was at the front of the book
    db().check_call_orders(base_asset(d));
    db().check_call_orders(quote_asset(d));
 
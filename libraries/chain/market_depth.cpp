@@ -0,0 +1,157 @@
+#include <bts/chain/market_depth.hpp>
+#include <bts/chain/database.hpp>
+#include <bts/chain/limit_order_object.hpp>
+#include <bts/chain/short_order_object.hpp>
+
+namespace bts { namespace chain {
+
+void market_depth::enable( const database& db )
+{
+   _enabled = true;
+   rebuild( db );
+}
+
+void market_depth::rebuild( const database& db )
+{
+   _books.clear();
+   _orders.clear();
+   _changed_levels.clear();
+   if( !_enabled ) return;
+
+   db.get_index_type<limit_order_index>().inspect_all_objects( [this]( const object& o ){ add_order( o ); } );
+   db.get_index_type<short_order_index>().inspect_all_objects( [this]( const object& o ){ add_order( o ); } );
+   db.get_index_type<call_order_index>().inspect_all_objects( [this]( const object& o ){ add_order( o ); } );
+   // a rebuild is not a change subscribers need to hear about
+   _changed_levels.clear();
+}
+
+vector<price_level> market_depth::get_levels( depth_order_type type, asset_id_type base, asset_id_type quote,
+                                              uint32_t limit )const
+{
+   vector<price_level> result;
+   book_key book{ type, base, quote };
+   auto book_itr = _books.find( book );
+   if( book_itr == _books.end() )
+      return result;
+
+   const book_levels& levels = book_itr->second;
+   result.reserve( std::min<size_t>( limit, levels.size() ) );
+   if( type == call_depth )
+   {
+      for( auto itr = levels.begin(); itr != levels.end() && result.size() < limit; ++itr )
+         result.push_back( make_level( book, itr->first, &itr->second ) );
+   }
+   else
+   {
+      for( auto itr = levels.rbegin(); itr != levels.rend() && result.size() < limit; ++itr )
+         result.push_back( make_level( book, itr->first, &itr->second ) );
+   }
+   return result;
+}
+
+vector<price_level> market_depth::get_changed_levels()const
+{
+   vector<price_level> result;
+   result.reserve( _changed_levels.size() );
+   for( const auto& changed : _changed_levels )
+   {
+      const level_totals* totals = nullptr;
+      auto book_itr = _books.find( changed.first );
+      if( book_itr != _books.end() )
+      {
+         auto level_itr = book_itr->second.find( changed.second );
+         if( level_itr != book_itr->second.end() )
+            totals = &level_itr->second;
+      }
+      result.push_back( make_level( changed.first, changed.second, totals ) );
+   }
+   return result;
+}
+
+void market_depth::on_add( const object& obj )
+{
+   if( !_enabled ) return;
+   add_order( obj );
+}
+
+void market_depth::on_modify( const object& obj )
+{
+   if( !_enabled ) return;
+   remove_order( obj.id );
+   add_order( obj );
+}
+
+void market_depth::on_remove( const object& obj )
+{
+   if( !_enabled ) return;
+   remove_order( obj.id );
+}
+
+void market_depth::add_order( const object& obj )
+{
+   order_entry entry;
+   if( obj.id.type() == limit_order_object_type )
+   {
+      const auto& order = static_cast<const limit_order_object&>(obj);
+      entry.book = book_key{ limit_depth, order.sell_price.base.asset_id, order.sell_price.quote.asset_id };
+      entry.sell_price = order.sell_price;
+      entry.for_sale = order.for_sale;
+   }
+   else if( obj.id.type() == short_order_object_type )
+   {
+      const auto& order = static_cast<const short_order_object&>(obj);
+      entry.book = book_key{ short_depth, order.sell_price.base.asset_id, order.sell_price.quote.asset_id };
+      entry.sell_price = order.sell_price;
+      entry.for_sale = order.for_sale;
+   }
+   else
+   {
+      const auto& order = static_cast<const call_order_object&>(obj);
+      entry.book = book_key{ call_depth, order.call_price.base.asset_id, order.call_price.quote.asset_id };
+      entry.sell_price = order.call_price;
+      entry.for_sale = order.collateral;
+   }
+
+   level_totals& level = _books[entry.book][entry.sell_price];
+   level.for_sale += entry.for_sale;
+   ++level.order_count;
+   _changed_levels.insert( std::make_pair( entry.book, entry.sell_price ) );
+   _orders[obj.id] = entry;
+}
+
+void market_depth::remove_order( object_id_type id )
+{
+   auto order_itr = _orders.find( id );
+   if( order_itr == _orders.end() )
+      return;
+   const order_entry& entry = order_itr->second;
+
+   auto book_itr = _books.find( entry.book );
+   assert( book_itr != _books.end() );
+   auto level_itr = book_itr->second.find( entry.sell_price );
+   assert( level_itr != book_itr->second.end() );
+   level_itr->second.for_sale -= entry.for_sale;
+   if( --level_itr->second.order_count == 0 )
+   {
+      book_itr->second.erase( level_itr );
+      if( book_itr->second.empty() )
+         _books.erase( book_itr );
+   }
+   _changed_levels.insert( std::make_pair( entry.book, entry.sell_price ) );
+   _orders.erase( order_itr );
+}
+
+price_level market_depth::make_level( const book_key& book, const price& p, const level_totals* totals )const
+{
+   price_level level;
+   level.order_type = book.order_type;
+   level.sell_price = p;
+   if( totals )
+   {
+      level.for_sale = totals->for_sale;
+      level.order_count = totals->order_count;
+   }
+   return level;
+}
+
+} } // bts::chain
@@ -51,6 +51,7 @@ object_id_type proposal_create_evaluator::do_apply(const proposal_create_operati
       std::set_difference(required_active.begin(), required_active.end(),
                           proposal.required_owner_approvals.begin(), proposal.required_owner_approvals.end(),
                           std::inserter(proposal.required_active_approvals, proposal.required_active_approvals.begin()));
+      proposal.count_approval_tallies(d);
    });
 
    return proposal.id;
@@ -96,16 +97,27 @@ object_id_type proposal_update_evaluator::do_apply(const proposal_update_operati
    // signature checks. This isn't done now because I just wrote all the proposals code, and I'm not yet 100% sure the
    // required approvals are sufficient to authorize the transaction.
    d.modify(*_proposal, [&o, &d](proposal_object& p) {
-      p.available_active_approvals.insert(o.active_approvals_to_add.begin(), o.active_approvals_to_add.end());
-      p.available_owner_approvals.insert(o.owner_approvals_to_add.begin(), o.owner_approvals_to_add.end());
+      // Only the approvals which actually change are counted toward the required authorities
+      vector<pair<object_id_type, authority::classification>> added, removed;
+      for( account_id_type id : o.active_approvals_to_add )
+         if( p.available_active_approvals.insert(id).second )
+            added.emplace_back(id, authority::active);
+      for( account_id_type id : o.owner_approvals_to_add )
+         if( p.available_owner_approvals.insert(id).second )
+            added.emplace_back(id, authority::owner);
       for( account_id_type id : o.active_approvals_to_remove )
-         p.available_active_approvals.erase(id);
+         if( p.available_active_approvals.erase(id) )
+            removed.emplace_back(id, authority::active);
       for( account_id_type id : o.owner_approvals_to_remove )
-         p.available_owner_approvals.erase(id);
+         if( p.available_owner_approvals.erase(id) )
+            removed.emplace_back(id, authority::owner);
       for( key_id_type id : o.key_approvals_to_add )
-         p.available_key_approvals.insert(id);
+         if( p.available_key_approvals.insert(id).second )
+            added.emplace_back(id, authority::key);
       for( key_id_type id : o.key_approvals_to_remove )
-         p.available_key_approvals.erase(id);
+         if( p.available_key_approvals.erase(id) )
+            removed.emplace_back(id, authority::key);
+      p.update_approval_tallies(d, added, removed);
    });
 
    // If the proposal has a review period, don't bother attempting to authorize/execute it.
@@ -4,36 +4,200 @@
 
 namespace bts { namespace chain {
 
-bool proposal_object::is_authorized_to_execute(database* db) const
+namespace {
+
+const authority& get_authority( const account_object& account, authority::classification auth_class )
+{
+   return auth_class == authority::owner ? account.owner : account.active;
+}
+
+/// Whether neither the account's authority nor that of an account nested in it has changed since the tally was counted
+bool tally_is_current( const database& db, const account_object& account, const approval_tally& tally )
+{
+   if( account.authority_revision > tally.authority_revision )
+      return false;
+   for( const auto& id : tally.nested_members )
+      if( id.type() == account_object_type && account_id_type(id)(db).authority_revision > tally.authority_revision )
+         return false;
+   return true;
+}
+
+/// Counts an approval which was just added or removed toward the auth_class authority of a required account
+void count_change( approval_tally& tally, const authority& auth, authority::classification auth_class,
+                   const pair<object_id_type, authority::classification>& change, bool added )
 {
-   transaction_evaluation_state dry_run_eval(db);
-   dry_run_eval._is_proposed_trx = true;
-   std::transform(available_active_approvals.begin(), available_active_approvals.end(),
-                  std::inserter(dry_run_eval.approved_by, dry_run_eval.approved_by.end()), [](object_id_type id) {
-      return make_pair(id, authority::active);
-   });
-   std::transform(available_owner_approvals.begin(), available_owner_approvals.end(),
-                  std::inserter(dry_run_eval.approved_by, dry_run_eval.approved_by.end()), [](object_id_type id) {
-      return make_pair(id, authority::owner);
-   });
+   // keys approve with every authority they are in, accounts only with the one they approved with
+   if( change.second != authority::key && change.second != auth_class )
+      return;
+   if( tally.nested_members.find( change.first ) != tally.nested_members.end() )
+   {
+      if( added )
+         ++tally.nested_approvals;
+      else
+         --tally.nested_approvals;
+   }
+
+   auto member = auth.auths.find( change.first );
+   if( member == auth.auths.end() )
+      return;
 
+   if( added )
+      tally.approved_weight += member->second;
+   else
+      tally.approved_weight -= member->second;
+   if( change.second != authority::key )
+   {
+      if( added )
+         tally.unapproved_account_weight -= member->second;
+      else
+         tally.unapproved_account_weight += member->second;
+   }
+}
+
+}
+
+bool proposal_object::is_authorized_to_execute(database* db) const
+{
+   // The authority walk is only needed where accounts in a required authority may be satisfied by approvals of their
+   // own, so the dry run it needs is only set up then.
    signed_transaction tmp;
-   dry_run_eval._trx = &tmp;
-   for( auto key_id : available_key_approvals )
-      tmp.signatures[key_id] = fc::ecc::compact_signature();
+   std::unique_ptr<transaction_evaluation_state> dry_run_eval;
+   auto walk_authority = [&]( const account_object& account, authority::classification auth_class ) -> bool {
+      if( !dry_run_eval )
+      {
+         dry_run_eval.reset( new transaction_evaluation_state(db) );
+         dry_run_eval->_is_proposed_trx = true;
+         std::transform(available_active_approvals.begin(), available_active_approvals.end(),
+                        std::inserter(dry_run_eval->approved_by, dry_run_eval->approved_by.end()), [](object_id_type id) {
+            return make_pair(id, authority::active);
+         });
+         std::transform(available_owner_approvals.begin(), available_owner_approvals.end(),
+                        std::inserter(dry_run_eval->approved_by, dry_run_eval->approved_by.end()), [](object_id_type id) {
+            return make_pair(id, authority::owner);
+         });
+
+         dry_run_eval->_trx = &tmp;
+         for( auto key_id : available_key_approvals )
+            tmp.signatures[key_id] = fc::ecc::compact_signature();
+      }
+      return dry_run_eval->check_authority( account, auth_class );
+   };
 
-   //insert into dry_run_eval->_trx.signatures
-   //dry_run_eval.signed_by.insert(available_key_approvals.begin(), available_key_approvals.end());
+   auto is_approved = [&]( account_id_type id, authority::classification auth_class ) -> bool {
+      const auto& available = auth_class == authority::owner ? available_owner_approvals : available_active_approvals;
+      if( available.find(id) != available.end() )
+         return true;
+
+      const account_object& account = id(*db);
+      const authority& auth = get_authority( account, auth_class );
+      const auto& tallies = auth_class == authority::owner ? owner_approval_tallies : active_approval_tallies;
+      auto itr = tallies.find(id);
+      const approval_tally* tally = nullptr;
+      approval_tally recounted;
+      if( itr != tallies.end() && tally_is_current( *db, account, itr->second ) )
+         tally = &itr->second;
+      else
+      {
+         recounted = count_approvals( *db, account, auth_class );
+         tally = &recounted;
+      }
+
+      // check_authority only compares against the threshold after counting a member, so an empty authority fails
+      if( auth.auths.empty() || tally->approved_weight + tally->unapproved_account_weight < auth.weight_threshold )
+         return false;
+      if( tally->approved_weight >= auth.weight_threshold )
+         return true;
+      if( tally->nested_approvals == 0 && !tally->nested_zero_threshold )
+         return false;
+      return walk_authority( account, auth_class );
+   };
 
    // Check all required approvals. If any of them are unsatisfied, return false.
    for( const auto& id : required_active_approvals )
-      if( !dry_run_eval.check_authority(id(*db), authority::active) )
+      if( !is_approved( id, authority::active ) )
          return false;
    for( const auto& id : required_owner_approvals )
-      if( !dry_run_eval.check_authority(id(*db), authority::owner) )
+      if( !is_approved( id, authority::owner ) )
          return false;
 
    return true;
 }
 
+void proposal_object::update_approval_tallies( const database& db,
+                                               const vector<pair<object_id_type, authority::classification>>& added,
+                                               const vector<pair<object_id_type, authority::classification>>& removed )
+{
+   auto update = [&]( flat_map<account_id_type, approval_tally>& tallies, authority::classification auth_class ) {
+      for( auto& entry : tallies )
+      {
+         const account_object& account = entry.first(db);
+         approval_tally& tally = entry.second;
+         if( !tally_is_current( db, account, tally ) )
+         {
+            tally = count_approvals( db, account, auth_class );
+            continue;
+         }
+         const authority& auth = get_authority( account, auth_class );
+         for( const auto& change : added )
+            count_change( tally, auth, auth_class, change, true );
+         for( const auto& change : removed )
+            count_change( tally, auth, auth_class, change, false );
+      }
+   };
+   update( active_approval_tallies, authority::active );
+   update( owner_approval_tallies, authority::owner );
+}
+
+void proposal_object::count_approval_tallies( const database& db )
+{
+   active_approval_tallies.clear();
+   for( const auto& id : required_active_approvals )
+      active_approval_tallies[id] = count_approvals( db, id(db), authority::active );
+   owner_approval_tallies.clear();
+   for( const auto& id : required_owner_approvals )
+      owner_approval_tallies[id] = count_approvals( db, id(db), authority::owner );
+}
+
+approval_tally proposal_object::count_approvals( const database& db, const account_object& account,
+                                                 authority::classification auth_class )const
+{
+   const auto& available = auth_class == authority::owner ? available_owner_approvals : available_active_approvals;
+   auto is_available = [&]( object_id_type id ) -> bool {
+      if( id.type() == key_object_type )
+         return available_key_approvals.find( key_id_type(id) ) != available_key_approvals.end();
+      return id.type() == account_object_type && available.find( account_id_type(id) ) != available.end();
+   };
+
+   approval_tally tally;
+   tally.authority_revision = db.get_dynamic_global_properties().authority_revision;
+   for( const auto& member : get_authority( account, auth_class ).auths )
+   {
+      if( is_available( member.first ) )
+         tally.approved_weight += member.second;
+      else if( member.first.type() == account_object_type )
+         tally.unapproved_account_weight += member.second;
+
+      // check_authority follows accounts to a depth of BTS_MAX_SIG_CHECK_DEPTH, where only direct approvals count
+      if( member.first.type() != account_object_type )
+         continue;
+      vector<object_id_type> nested_accounts( 1, member.first );
+      for( int depth = 1; depth <= BTS_MAX_SIG_CHECK_DEPTH && !nested_accounts.empty(); ++depth )
+      {
+         vector<object_id_type> next_accounts;
+         for( const auto& nested_id : nested_accounts )
+         {
+            const authority& nested_auth = get_authority( account_id_type(nested_id)(db), auth_class );
+            tally.nested_zero_threshold |= nested_auth.weight_threshold == 0;
+            for( const auto& nested : nested_auth.auths )
+               if( tally.nested_members.insert( nested.first ).second && nested.first.type() == account_object_type )
+                  next_accounts.push_back( nested.first );
+         }
+         nested_accounts = std::move( next_accounts );
+      }
+   }
+   for( const auto& id : tally.nested_members )
+      tally.nested_approvals += is_available( id );
+   return tally;
+}
+
 } } // bts::chain
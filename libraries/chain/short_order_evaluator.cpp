@@ -54,7 +54,7 @@ object_id_type short_order_create_evaluator::do_apply( const short_order_create_
        obj.seller                       = _seller->id;
        obj.for_sale                     = op.amount_to_sell.amount;
        obj.available_collateral         = op.collateral.amount;
-       obj.sell_price                   = op.sell_price();
+       obj.set_sell_price( op.sell_price() );
        obj.call_price                   = op.call_price();
        obj.initial_collateral_ratio     = op.initial_collateral_ratio;
        obj.maintenance_collateral_ratio = op.maintenance_collateral_ratio;
@@ -70,9 +70,7 @@ object_id_type short_order_create_evaluator::do_apply( const short_order_create_
       });
    }
 
-   // Possible optimization: We only need to check calls if both are true:
-   //  - The new order is at the front of the book
-   //  - The new order is below the call limit price
+   // check_call_orders returns immediately unless the new order crossed the call trigger at the front of the book
    db().check_call_orders(*_sell_asset);
 
    if( !db().find(new_id) ) // then we were filled by call order
@@ -83,10 +81,11 @@ object_id_type short_order_create_evaluator::do_apply( const short_order_create_
 
    auto min_limit_price  = ~op.sell_price();
 
+   // the bids crossed by the new order are those at the front of its market, ending with the first that does not cross
    auto itr = limit_price_idx.lower_bound( min_limit_price.max() );
-   auto end = limit_price_idx.upper_bound( min_limit_price );
+   auto end = limit_price_idx.end();
 
-   while( itr != end )
+   while( itr != end && itr->sell_price >= min_limit_price )
    {
       auto old_itr = itr;
       ++itr;
@@ -132,8 +131,7 @@ asset short_order_cancel_evaluator::do_apply( const short_order_cancel_operation
       });
    }
 
-   // Possible optimization: order can be called by canceling a short order iff the canceled order was at the top of the book.
-   // Do I need to check calls in both assets?
+   // check_call_orders returns immediately unless the canceled order was at the front of the book
    db().check_call_orders(base_asset(d));
    db().check_call_orders(quote_asset(d));
 
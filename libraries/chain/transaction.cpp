@@ -3,6 +3,15 @@
 
 namespace bts { namespace chain {
 
+namespace {
+   transaction_id_type id_from_digest( const digest_type& hash )
+   {
+      transaction_id_type result;
+      memcpy(result._hash, hash._hash, std::min(sizeof(result), sizeof(hash)));
+      return result;
+   }
+}
+
 digest_type transaction::digest(const block_id_type& ref_block_id) const
 {
    digest_type::encoder enc;
@@ -38,10 +47,23 @@ bts::chain::transaction_id_type bts::chain::transaction::id() const
 {
    digest_type::encoder enc;
    fc::raw::pack(enc, *this);
-   auto hash = enc.result();
-   transaction_id_type result;
-   memcpy(result._hash, hash._hash, std::min(sizeof(result), sizeof(hash)));
-   return result;
+   return id_from_digest( enc.result() );
+}
+
+transaction_digests::transaction_digests( const transaction& trx )
+   : _packed( fc::raw::pack( trx ) ),
+     _digest( digest_type::hash( _packed.data(), _packed.size() ) ),
+     _id( id_from_digest( _digest ) )
+{
+}
+
+digest_type transaction_digests::digest( const block_id_type& ref_block_id )const
+{
+   // identical to transaction::digest(ref_block_id), which packs the reference block id followed by the transaction
+   digest_type::encoder enc;
+   fc::raw::pack( enc, ref_block_id );
+   enc.write( _packed.data(), _packed.size() );
+   return enc.result();
 }
 void bts::chain::signed_transaction::sign( key_id_type id, const private_key_type& key )
 {
@@ -55,4 +77,29 @@ void bts::chain::signed_transaction::sign( key_id_type id, const private_key_typ
    }
 }
 
+flat_map<key_id_type,address> bts::chain::signed_transaction::get_signature_addresses( const digest_type& trx_digest )const
+{
+   if( signature_cache_digest != trx_digest )
+   {
+      signature_cache.clear();
+      signature_cache_digest = trx_digest;
+   }
+
+   flat_map<key_id_type,address> result;
+   result.reserve( signatures.size() );
+   for( const auto& sig : signatures )
+   {
+      auto itr = signature_cache.find( sig.first );
+      if( itr == signature_cache.end() || itr->second.first != sig.second )
+      {
+         address signee( fc::ecc::public_key( sig.second, trx_digest ) );
+         signature_cache[sig.first] = std::make_pair( sig.second, signee );
+         result[sig.first] = signee;
+      }
+      else
+         result[sig.first] = itr->second.second;
+   }
+   return result;
+}
+
 } } // bts::chain
@@ -13,6 +13,44 @@ namespace bts { namespace chain {
 
       FC_ASSERT( account.id.instance() != 0 || _is_proposed_trx );
 
+      // A check made from the signatures alone can be shared with other transactions signed by the same keys.  Proposals
+      // seed approvals of their own, and approvals already made in this transaction can mask a recursion depth failure.
+      if( depth == 0 && _trx && !_is_proposed_trx )
+      {
+         if( _signing_keys.empty() )
+            for( const auto& sig : _trx->signatures )
+               _signing_keys.push_back( sig.first );
+         authority_cache& cache = _db->get_authority_cache();
+         if( cache.is_approved( account.id, auth_class, _signing_keys ) )
+         {
+            approved_by.insert( std::make_pair(account.id, auth_class) );
+            return true;
+         }
+         if( approved_by.empty() )
+         {
+            vector<account_id_type> accounts_read;
+            _accounts_read = &accounts_read;
+            bool approved = false;
+            try {
+               approved = resolve_authority( account, auth_class, depth );
+            } catch( ... ) {
+               _accounts_read = nullptr;
+               throw;
+            }
+            _accounts_read = nullptr;
+            if( approved )
+               cache.add_approval( account.id, auth_class, _signing_keys, accounts_read );
+            return approved;
+         }
+      }
+      return resolve_authority( account, auth_class, depth );
+   }
+
+   bool transaction_evaluation_state::resolve_authority( const account_object& account, authority::classification auth_class, int depth )
+   {
+      if( _accounts_read )
+         _accounts_read->push_back( account.id );
+
       const authority* au = nullptr;
       switch( auth_class )
       {
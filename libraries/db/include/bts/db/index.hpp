@@ -176,6 +176,14 @@ namespace bts { namespace db {
             return result;
          }
 
+         /** used to restore objects when undoing; the object is not new, so only the observers are notified */
+         virtual const object&  insert( object&& obj ) override
+         {
+            const auto& result = DerivedIndex::insert( std::move(obj) );
+            for( const auto& ob : _observers ) ob->on_add( result );
+            return result;
+         }
+
          virtual void  remove( const object& obj ) override
          {
             on_remove(obj);
@@ -48,6 +48,8 @@ namespace bts { namespace db {
          /// these methods are implemented for derived classes by inheriting abstract_object<DerivedClass>
          virtual unique_ptr<object> clone()const = 0;
          virtual void               move_from( object& obj ) = 0;
+         /// copy assigns obj, which must be of the same type, reusing any storage already held by this object
+         virtual void               copy_from( const object& obj ) = 0;
          virtual variant            to_variant()const  = 0;
          virtual vector<char>       pack()const = 0;
    };
@@ -72,6 +74,10 @@ namespace bts { namespace db {
          {
             static_cast<DerivedClass&>(*this) = std::move( static_cast<DerivedClass&>(obj) );
          }
+         virtual void    copy_from( const object& obj )
+         {
+            static_cast<DerivedClass&>(*this) = static_cast<const DerivedClass&>(obj);
+         }
          virtual variant to_variant()const { return variant( static_cast<const DerivedClass&>(*this) ); }
          virtual vector<char> pack()const  { return fc::raw::pack( static_cast<const DerivedClass&>(*this) ); }
    };
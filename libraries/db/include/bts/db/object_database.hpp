@@ -2,6 +2,7 @@
 #include <bts/db/object.hpp>
 #include <bts/db/index.hpp>
 #include <bts/db/undo_database.hpp>
+#include <bts/db/object_snapshot.hpp>
 
 #include <bts/db/level_map.hpp>
 #include <bts/db/level_pod_map.hpp>
@@ -9,6 +10,8 @@
 #include <fc/log/logger.hpp>
 
 #include <map>
+#include <memory>
+#include <unordered_set>
 
 namespace bts { namespace db {
 
@@ -27,12 +30,31 @@ namespace bts { namespace db {
          void open(const fc::path& data_dir );
 
          /**
-          * Saves the complete state of the object_database to disk, this could take a while
+          * Saves the objects which were created, modified or removed since the last flush to disk in a single
+          * atomic, synchronous write batch.  The cost of a flush is proportional to the churn since the previous
+          * flush, not to the size of the state.  Because the batch is atomic, the data on disk always reflects the
+          * state as of some flush, which makes flush() suitable for taking crash-consistent checkpoints.
           */
          void flush();
          void wipe(const fc::path& data_dir); // remove from disk
          void close();
 
+         /**
+          * Start tracking changes for read snapshots, and publish a snapshot of the current state with the given
+          * revision.  This copies every object, so it should be done once, after opening the database.
+          */
+         void enable_snapshots( uint64_t revision );
+         /**
+          * Publish a snapshot of the current state, tagged with revision.  Only the objects changed since the previous
+          * snapshot are copied.  Does nothing unless enable_snapshots() has been called.
+          */
+         void publish_snapshot( uint64_t revision );
+         /**
+          * @return the most recently published snapshot, or null if snapshots are not enabled.  Unlike every other
+          * method of object_database, this may be called from any thread.
+          */
+         std::shared_ptr<const object_snapshot> get_snapshot()const { return std::atomic_load( &_snapshot ); }
+
          template<typename T, typename F>
          const T& create( F&& constructor )
          {
@@ -64,7 +86,13 @@ namespace bts { namespace db {
          /// in order to maintain proper undo history.
          ///@{
 
-         const object& insert( object&& obj ) { return get_mutable_index(obj.id).insert( std::move(obj) ); }
+         const object& insert( object&& obj )
+         {
+            auto id = obj.id;
+            const object& result = get_mutable_index(id).insert( std::move(obj) );
+            mark_dirty( id );
+            return result;
+         }
          void          remove( const object& obj ) { get_mutable_index(obj.id).remove( obj ); }
          template<typename T, typename Lambda>
          void modify( const T& obj, const Lambda& m ) {
@@ -131,9 +159,32 @@ namespace bts { namespace db {
          void save_undo_add( const object& obj );
          void save_undo_remove( const object& obj );
 
+         /** track objects which must be written or erased by the next flush() */
+         void mark_dirty( object_id_type id )
+         {
+            _removed_objects.erase(id); _dirty_objects.insert(id);
+            if( _snapshots_enabled ) _snapshot_changes.insert(id);
+         }
+         void mark_removed( object_id_type id )
+         {
+            _dirty_objects.erase(id); _removed_objects.insert(id);
+            if( _snapshots_enabled ) _snapshot_changes.insert(id);
+         }
+
          fc::path                                                  _data_dir;
          vector< vector< unique_ptr<index> > >                     _index;
          shared_ptr<db::level_map<object_id_type, vector<char> >>  _object_id_to_object;
+
+         /** objects created or modified since the last flush */
+         std::unordered_set<object_id_type>                        _dirty_objects;
+         /** objects removed since the last flush */
+         std::unordered_set<object_id_type>                        _removed_objects;
+
+         bool                                                      _snapshots_enabled = false;
+         /** objects created, modified or removed since the last published snapshot */
+         std::unordered_set<object_id_type>                        _snapshot_changes;
+         /** only ever accessed through std::atomic_load and std::atomic_store */
+         std::shared_ptr<const object_snapshot>                    _snapshot;
    };
 
 } } // bts::db
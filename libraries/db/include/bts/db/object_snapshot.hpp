@@ -0,0 +1,75 @@
+#pragma once
+#include <bts/db/object.hpp>
+
+#include <fc/container/flat.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <array>
+
+namespace bts { namespace db {
+
+   /**
+    * @class object_snapshot
+    * @brief an immutable copy of every object in an object_database as of one point in time
+    *
+    * Snapshots are published by object_database::publish_snapshot().  Once published a snapshot never changes, so any
+    * number of threads may read it without locking while the database moves on, and every read sees the state as of
+    * the same revision.
+    *
+    * Objects are stored by instance in fixed size chunks, which are grouped into pages, per object type.  Publishing a
+    * snapshot copies only the pages and chunks which hold objects changed since the previous snapshot and shares all
+    * the others with it, so keeping snapshots costs memory and time proportional to the churn between them.
+    */
+   class object_snapshot
+   {
+      public:
+         /// the revision passed to object_database::publish_snapshot(), such as the head block number
+         uint64_t      revision()const { return _revision; }
+
+         const object* find_object( object_id_type id )const;
+         const object& get_object( object_id_type id )const
+         {
+            const object* obj = find_object( id );
+            FC_ASSERT( obj, "Unknown object", ("id",id) );
+            return *obj;
+         }
+
+         template<typename T>
+         const T* find( object_id_type id )const
+         {
+            const object* obj = find_object( id );
+            assert(  !obj || nullptr != dynamic_cast<const T*>(obj) );
+            return static_cast<const T*>(obj);
+         }
+         template<typename T>
+         const T& get( object_id_type id )const
+         {
+            const object& obj = get_object( id );
+            assert( nullptr != dynamic_cast<const T*>(&obj) );
+            return static_cast<const T&>(obj);
+         }
+
+         template<uint8_t SpaceID, uint8_t TypeID, typename T>
+         const T* find( object_id<SpaceID,TypeID,T> id )const { return find<T>(id); }
+
+         template<uint8_t SpaceID, uint8_t TypeID, typename T>
+         const T& get( object_id<SpaceID,TypeID,T> id )const { return get<T>(id); }
+
+      private:
+         friend class object_database;
+
+         static const uint32_t chunk_bits = 6;
+         static const uint32_t page_bits  = 6;
+
+         typedef std::array< std::shared_ptr<const object>, 1 << chunk_bits > chunk;
+         typedef std::array< std::shared_ptr<chunk>, 1 << page_bits >         page;
+         typedef vector< std::shared_ptr<page> >                              table;
+
+         /// replace (or, given null, remove) the copy of id; only called before the snapshot is published
+         void set( object_id_type id, unique_ptr<object> obj );
+
+         uint64_t                      _revision = 0;
+         fc::flat_map<uint16_t, table> _tables; ///< keyed by object_id_type::space_type()
+   };
+
+} } // bts::db
@@ -1,6 +1,5 @@
 #pragma once
 #include <bts/db/object.hpp>
-#include <deque>
 #include <fc/exception/exception.hpp>
 
 namespace bts { namespace db {
@@ -9,12 +8,59 @@ namespace bts { namespace db {
    using fc::flat_set;
    class object_database;
 
+   /**
+    * @class object_id_set
+    * @brief open-addressed set of object ids which keeps its storage when cleared
+    *
+    * Once the table has grown to the working set of an undo state, inserting and clearing no longer allocate.  Ids in
+    * space 0 are relative ids which never name a stored object, so the null id marks an empty slot.
+    */
+   class object_id_set
+   {
+      public:
+         /** @return true if id was not already in the set */
+         bool insert( object_id_type id );
+         bool contains( object_id_type id )const;
+         void clear();
+         size_t size()const { return _used.size(); }
+
+      private:
+         size_t slot_for( object_id_type id )const;
+         void   grow();
+
+         vector<object_id_type> _slots;
+         vector<uint32_t>       _used;
+         uint32_t               _shift = 64;
+   };
+
+   /**
+    * A single change recorded by an undo state.  Changes are undone by replaying the log in reverse: created objects
+    * are removed (and their index's next id rewound to them), modified objects are restored to old_value and removed
+    * objects are re-inserted from old_value.
+    */
+   struct undo_change
+   {
+      enum change_type : uint8_t
+      {
+         created,
+         modified,
+         removed
+      };
+
+      undo_change( change_type t, object_id_type i, unique_ptr<object> v = unique_ptr<object>() )
+      :type(t),id(i),old_value(std::move(v)){}
+
+      change_type         type;
+      object_id_type      id;
+      unique_ptr<object>  old_value;
+   };
+
    struct undo_state
    {
-      unordered_map<object_id_type, unique_ptr<object> > old_values;
-      unordered_map<object_id_type, object_id_type>      old_index_next_ids;
-      std::unordered_set<object_id_type>                 new_ids;
-      unordered_map<object_id_type, unique_ptr<object> > removed;
+      /// all changes in the order they were made
+      vector<undo_change> changes;
+      /// objects which were created or already saved in this state, and need not be saved again if modified
+      object_id_set       saved_ids;
    };
 
 
@@ -46,7 +92,7 @@ namespace bts { namespace db {
                      throw; // maybe crash..
                   }
                }
-               void commit() { _apply_undo = false; _db.commit();  }
+               void commit() { if( _apply_undo ) _db.commit(); _apply_undo = false; }
                void undo()   { if( _apply_undo ) _db.undo(); _apply_undo = false; }
                void merge()  { if( _apply_undo ) _db.merge(); _apply_undo = false; }
 
@@ -111,11 +157,25 @@ namespace bts { namespace db {
          void merge();
          void commit();
 
+         /** reverts every change in state, most recent first */
+         void               undo_changes( undo_state& state );
+         void               push_state();
+         void               release_state( undo_state&& state );
+         unique_ptr<object> acquire_snapshot( const object& obj );
+         void               release_snapshot( unique_ptr<object>&& snapshot );
+
          uint32_t                _active_sessions = 0;
          bool                    _disabled = true;
-         std::deque<undo_state>  _stack;
+         vector<undo_state>      _stack;
          object_database&        _db;
          size_t                  _max_size = 256;
+
+         /**
+          * Retired undo states and object copies are kept for reuse so that undo sessions do not allocate in steady
+          * state.  Snapshots are pooled by the space and type of the object they hold.
+          */
+         vector<undo_state>                                 _free_states;
+         flat_map<uint16_t, vector<unique_ptr<object>>>     _free_snapshots;
    };
 
 } } // bts::db
@@ -62,13 +62,24 @@ void object_database::flush()
    for( auto& space : _index )
       for( const unique_ptr<index>& type_index : space )
          if( type_index )
-         {
-            type_index->inspect_all_objects([&] (const object& obj) {
-               _object_id_to_object->store(obj.id, obj.pack());
-            });
             next_ids.push_back( type_index->get_next_id() );
-         }
-   _object_id_to_object->store( object_id_type(), fc::raw::pack(next_ids) );
+
+   auto batch = _object_id_to_object->create_batch( true );
+   for( const auto& id : _removed_objects )
+      batch.remove( id );
+   for( const auto& id : _dirty_objects )
+   {
+      const object* obj = find_object( id );
+      if( obj )
+         batch.store( id, obj->pack() );
+      else
+         batch.remove( id );
+   }
+   batch.store( object_id_type(), fc::raw::pack(next_ids) );
+   batch.commit();
+
+   _dirty_objects.clear();
+   _removed_objects.clear();
 }
 
 void object_database::wipe(const fc::path& data_dir)
@@ -77,6 +88,13 @@ void object_database::wipe(const fc::path& data_dir)
    ilog("Wiping object_database.");
    fc::remove_all(data_dir / "object_database");
    assert(!fc::exists(data_dir / "object_database"));
+
+   // Nothing is on disk anymore, so the next flush must write every live object
+   _removed_objects.clear();
+   for( auto& space : _index )
+      for( const unique_ptr<index>& type_index : space )
+         if( type_index )
+            type_index->inspect_all_objects([&] (const object& obj) { _dirty_objects.insert(obj.id); });
 }
 
 void object_database::open( const fc::path& data_dir )
@@ -114,6 +132,37 @@ void object_database::open( const fc::path& data_dir )
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
 
 
+void object_database::enable_snapshots( uint64_t revision )
+{
+   auto snapshot = std::make_shared<object_snapshot>();
+   snapshot->_revision = revision;
+   for( auto& space : _index )
+      for( const unique_ptr<index>& type_index : space )
+         if( type_index )
+            type_index->inspect_all_objects( [&]( const object& obj ) { snapshot->set( obj.id, obj.clone() ); } );
+
+   _snapshots_enabled = true;
+   _snapshot_changes.clear();
+   std::atomic_store( &_snapshot, std::shared_ptr<const object_snapshot>( std::move(snapshot) ) );
+}
+
+void object_database::publish_snapshot( uint64_t revision )
+{
+   if( !_snapshots_enabled )
+      return;
+
+   // Only this thread ever stores _snapshot, so it can be read here without atomic_load
+   auto snapshot = std::make_shared<object_snapshot>( *_snapshot );
+   snapshot->_revision = revision;
+   for( const auto& id : _snapshot_changes )
+   {
+      const object* obj = find_object( id );
+      snapshot->set( id, obj ? obj->clone() : unique_ptr<object>() );
+   }
+   _snapshot_changes.clear();
+   std::atomic_store( &_snapshot, std::shared_ptr<const object_snapshot>( std::move(snapshot) ) );
+}
+
 void object_database::pop_undo()
 { try {
    _undo_db.pop_commit();
@@ -122,16 +171,19 @@ void object_database::pop_undo()
 void object_database::save_undo( const object& obj )
 {
    _undo_db.on_modify( obj );
+   mark_dirty( obj.id );
 }
 
 void object_database::save_undo_add( const object& obj )
 {
    _undo_db.on_create( obj );
+   mark_dirty( obj.id );
 }
 
 void object_database::save_undo_remove(const object& obj)
 {
    _undo_db.on_remove( obj );
+   mark_removed( obj.id );
 }
 
 } } // namespace bts::db
@@ -0,0 +1,59 @@
+#include <bts/db/object_snapshot.hpp>
+
+namespace bts { namespace db {
+
+const object* object_snapshot::find_object( object_id_type id )const
+{
+   auto itr = _tables.find( id.space_type() );
+   if( itr == _tables.end() )
+      return nullptr;
+
+   const uint64_t instance = id.instance();
+   const uint64_t page_num = instance >> (chunk_bits + page_bits);
+   const table& pages = itr->second;
+   if( page_num >= pages.size() || !pages[page_num] )
+      return nullptr;
+   const auto& chunk_ptr = (*pages[page_num])[(instance >> chunk_bits) & ((1 << page_bits) - 1)];
+   if( !chunk_ptr )
+      return nullptr;
+   return (*chunk_ptr)[instance & ((1 << chunk_bits) - 1)].get();
+}
+
+void object_snapshot::set( object_id_type id, unique_ptr<object> obj )
+{
+   const uint64_t instance = id.instance();
+   const uint64_t page_num = instance >> (chunk_bits + page_bits);
+   table& pages = _tables[id.space_type()];
+   if( page_num >= pages.size() )
+   {
+      if( !obj )
+         return;
+      pages.resize( page_num + 1 );
+   }
+
+   // A page or chunk still referenced by an earlier snapshot is copied before it is changed.  One referenced only by
+   // this snapshot was created or copied while building it, and no reader can see it yet.
+   auto& page_ptr = pages[page_num];
+   if( !page_ptr )
+   {
+      if( !obj )
+         return;
+      page_ptr = std::make_shared<page>();
+   }
+   else if( page_ptr.use_count() > 1 )
+      page_ptr = std::make_shared<page>( *page_ptr );
+
+   auto& chunk_ptr = (*page_ptr)[(instance >> chunk_bits) & ((1 << page_bits) - 1)];
+   if( !chunk_ptr )
+   {
+      if( !obj )
+         return;
+      chunk_ptr = std::make_shared<chunk>();
+   }
+   else if( chunk_ptr.use_count() > 1 )
+      chunk_ptr = std::make_shared<chunk>( *chunk_ptr );
+
+   (*chunk_ptr)[instance & ((1 << chunk_bits) - 1)] = std::shared_ptr<const object>( std::move(obj) );
+}
+
+} } // bts::db
@@ -4,17 +4,79 @@
 
 namespace bts { namespace db {
 
+size_t object_id_set::slot_for( object_id_type id )const
+{
+   // Fibonacci hashing; sequential instances land far apart
+   return size_t( (id.number * 0x9E3779B97F4A7C15ull) >> _shift );
+}
+
+bool object_id_set::contains( object_id_type id )const
+{
+   if( _slots.empty() ) return false;
+   size_t mask = _slots.size() - 1;
+   for( size_t i = slot_for( id ); !_slots[i].is_null(); i = (i + 1) & mask )
+      if( _slots[i] == id )
+         return true;
+   return false;
+}
+
+bool object_id_set::insert( object_id_type id )
+{
+   assert( !id.is_null() );
+   if( (_used.size() + 1) * 2 > _slots.size() )
+      grow();
+   size_t mask = _slots.size() - 1;
+   size_t i = slot_for( id );
+   for( ; !_slots[i].is_null(); i = (i + 1) & mask )
+      if( _slots[i] == id )
+         return false;
+   _slots[i] = id;
+   _used.push_back( i );
+   return true;
+}
+
+void object_id_set::clear()
+{
+   for( auto i : _used )
+      _slots[i] = object_id_type();
+   _used.clear();
+}
+
+void object_id_set::grow()
+{
+   vector<object_id_type> old_slots;
+   old_slots.reserve( _used.size() );
+   for( auto i : _used )
+      old_slots.push_back( _slots[i] );
+
+   _shift = _slots.empty() ? 58 : _shift - 1;
+   _slots.assign( size_t(1) << (64 - _shift), object_id_type() );
+   _used.clear();
+   _used.reserve( _slots.size() / 2 );
+   for( auto id : old_slots )
+      insert( id );
+}
+
 void undo_database::enable()  { _disabled = false; }
 void undo_database::disable() { _disabled = true; }
 
 undo_database::session undo_database::start_undo_session()
 {
-   if( _disabled ) return session(*this);
+   if( _disabled )
+   {
+      // nothing is being recorded, so there is nothing for the session to commit or undo
+      session inert(*this);
+      inert._apply_undo = false;
+      return inert;
+   }
 
    if( size() == max_size() )
-      _stack.pop_front();
+   {
+      release_state( std::move( _stack.front() ) );
+      _stack.erase( _stack.begin() );
+   }
 
-   _stack.emplace_back();
+   push_state();
    ++_active_sessions;
    return session(*this);
 }
@@ -23,47 +85,52 @@ void undo_database::on_create( const object& obj )
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      push_state();
    auto& state = _stack.back();
-   auto index_id = object_id_type( obj.id.space(), obj.id.type(), 0 );
-   auto itr = state.old_index_next_ids.find( index_id );
-   if( itr == state.old_index_next_ids.end() )
-      state.old_index_next_ids[index_id] = obj.id;
-   state.new_ids.insert(obj.id);
+   state.changes.emplace_back( undo_change::created, obj.id );
+   state.saved_ids.insert( obj.id );
 }
 void undo_database::on_modify( const object& obj )
 {
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      push_state();
    auto& state = _stack.back();
-   if( state.new_ids.find(obj.id) != state.new_ids.end() )
+   if( !state.saved_ids.insert( obj.id ) )
       return;
-   auto itr =  state.old_values.find(obj.id);
-   if( itr != state.old_values.end() ) return;
-   state.old_values[obj.id] = obj.clone();
+   state.changes.emplace_back( undo_change::modified, obj.id, acquire_snapshot( obj ) );
 }
 void undo_database::on_remove( const object& obj )
 {
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
-   undo_state& state = _stack.back();
-   if( state.new_ids.count(obj.id) )
-   {
-      state.new_ids.erase(obj.id);
-      return;
-   }
-   if( state.old_values.count(obj.id) )
+      push_state();
+   auto& state = _stack.back();
+   // Always recorded, even for objects created in this state, so that undoing the creation finds the object to remove
+   state.changes.emplace_back( undo_change::removed, obj.id, acquire_snapshot( obj ) );
+}
+
+void undo_database::undo_changes( undo_state& state )
+{
+   for( auto ritr = state.changes.rbegin(); ritr != state.changes.rend(); ++ritr )
    {
-      state.removed[obj.id] = std::move(state.old_values[obj.id]);
-      state.old_values.erase(obj.id);
-      return;
+      auto& change = *ritr;
+      switch( change.type )
+      {
+         case undo_change::created:
+            _db.remove( _db.get_object( change.id ) );
+            _db.get_mutable_index( change.id.space(), change.id.type() ).set_next_id( change.id );
+            break;
+         case undo_change::modified:
+            _db.modify( _db.get_object( change.id ), [&]( object& obj ){ obj.move_from( *change.old_value ); } );
+            break;
+         case undo_change::removed:
+            _db.insert( std::move(*change.old_value) );
+            break;
+      }
    }
-   if( state.removed.count(obj.id) ) return;
-   state.removed[obj.id] = obj.clone();
 }
 
 void undo_database::undo()
@@ -72,28 +139,12 @@ void undo_database::undo()
    FC_ASSERT( _active_sessions > 0 );
    disable();
 
-   auto& state = _stack.back();
-   for( auto& item : state.old_values )
-   {
-      _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
-   }
-
-   for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
-   {
-      _db.remove( _db.get_object(*ritr) );
-   }
-
-   for( auto& item : state.old_index_next_ids )
-   {
-      _db.get_mutable_index( item.first.space(), item.first.type() ).set_next_id( item.second );
-   }
-
-   for( auto& item : state.removed )
-      _db.insert( std::move(*item.second) );
+   undo_changes( _stack.back() );
 
+   release_state( std::move( _stack.back() ) );
    _stack.pop_back();
    if( _stack.empty() )
-      _stack.emplace_back();
+      push_state();
    enable();
    --_active_sessions;
 } FC_CAPTURE_AND_RETHROW() }
@@ -104,25 +155,19 @@ void undo_database::merge()
    FC_ASSERT( _stack.size() >=2 );
    auto& state = _stack.back();
    auto& prev_state = _stack[_stack.size()-2];
-   for( auto& obj : state.old_values )
+   for( auto& change : state.changes )
    {
-      if( prev_state.new_ids.find(obj.second->id) != prev_state.new_ids.end() )
+      // prev_state restores this object to an older value on undo, so the newer copy is redundant
+      if( change.type == undo_change::modified && prev_state.saved_ids.contains( change.id ) )
+      {
+         release_snapshot( std::move( change.old_value ) );
          continue;
-      if( prev_state.old_values.find(obj.second->id) == prev_state.old_values.end() )
-         prev_state.old_values[obj.second->id] = std::move(obj.second);
-   }
-   for( auto id : state.new_ids )
-      prev_state.new_ids.insert(id);
-   for( auto& item : state.old_index_next_ids )
-   {
-      if( prev_state.old_index_next_ids.find( item.first ) == prev_state.old_index_next_ids.end() )
-         prev_state.old_index_next_ids[item.first] = item.second;
+      }
+      if( change.type != undo_change::removed )
+         prev_state.saved_ids.insert( change.id );
+      prev_state.changes.push_back( std::move( change ) );
    }
-   for( auto& obj : state.removed )
-      if( prev_state.new_ids.find(obj.second->id) == prev_state.new_ids.end() )
-         prev_state.removed[obj.second->id] = std::move(obj.second);
-      else
-         prev_state.new_ids.erase(obj.second->id);
+   release_state( std::move( state ) );
    _stack.pop_back();
    --_active_sessions;
 }
@@ -139,26 +184,9 @@ void undo_database::pop_commit()
 
    disable();
    try {
-      auto& state = _stack.back();
-
-      for( auto& item : state.old_values )
-      {
-         _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
-      }
-
-      for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
-      {
-         _db.remove( _db.get_object(*ritr) );
-      }
-
-      for( auto& item : state.old_index_next_ids )
-      {
-         _db.get_mutable_index( item.first.space(), item.first.type() ).set_next_id( item.second );
-      }
-
-      for( auto& item : state.removed )
-         _db.insert( std::move(*item.second) );
+      undo_changes( _stack.back() );
 
+      release_state( std::move( _stack.back() ) );
       _stack.pop_back();
    }
    catch ( const fc::exception& e )
@@ -175,4 +203,41 @@ const undo_state& undo_database::head()const
    return _stack.back();
 }
 
+void undo_database::push_state()
+{
+   if( _free_states.empty() )
+   {
+      _stack.emplace_back();
+      return;
+   }
+   _stack.push_back( std::move( _free_states.back() ) );
+   _free_states.pop_back();
+}
+
+void undo_database::release_state( undo_state&& state )
+{
+   for( auto& change : state.changes )
+      if( change.old_value )
+         release_snapshot( std::move( change.old_value ) );
+   state.changes.clear();
+   state.saved_ids.clear();
+   _free_states.push_back( std::move( state ) );
+}
+
+unique_ptr<object> undo_database::acquire_snapshot( const object& obj )
+{
+   auto& pool = _free_snapshots[obj.id.space_type()];
+   if( pool.empty() )
+      return obj.clone();
+   auto snapshot = std::move( pool.back() );
+   pool.pop_back();
+   snapshot->copy_from( obj );
+   return snapshot;
+}
+
+void undo_database::release_snapshot( unique_ptr<object>&& snapshot )
+{
+   _free_snapshots[snapshot->id.space_type()].push_back( std::move( snapshot ) );
+}
+
 } } // bts::db
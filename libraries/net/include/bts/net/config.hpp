@@ -59,3 +59,15 @@
 #define BTS_NET_MIN_BLOCK_IDS_TO_PREFETCH               10000
 
 #define BTS_NET_MAX_TRX_PER_SECOND                      1000
+
+/**
+ * Idle message body buffers are kept for reuse by incoming messages in size
+ * classes, each holding buffers of twice the capacity of the one below it, from
+ * the smallest to the largest buffer size (in bytes) that will be kept.  Each
+ * class keeps at most BTS_NET_MESSAGE_BUFFER_POOL_SIZE buffers, and at most
+ * BTS_NET_MESSAGE_BUFFER_POOL_MAX_IDLE_SIZE bytes are kept idle in all.
+ */
+#define BTS_NET_MESSAGE_BUFFER_POOL_SIZE                64
+#define BTS_NET_MESSAGE_BUFFER_POOL_MIN_BUFFER_SIZE     256
+#define BTS_NET_MESSAGE_BUFFER_POOL_MAX_BUFFER_SIZE     (MAX_MESSAGE_SIZE)
+#define BTS_NET_MESSAGE_BUFFER_POOL_MAX_IDLE_SIZE       (1024*1024*8)
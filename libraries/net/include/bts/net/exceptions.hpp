@@ -9,5 +9,6 @@ namespace bts { namespace net {
    FC_DECLARE_DERIVED_EXCEPTION( insufficient_relay_fee,                bts::net::net_exception, 90002, "insufficient relay fee" );
    FC_DECLARE_DERIVED_EXCEPTION( already_connected_to_requested_peer,   bts::net::net_exception, 90003, "already connected to requested peer" );
    FC_DECLARE_DERIVED_EXCEPTION( block_older_than_undo_history,         bts::net::net_exception, 90004, "block is older than our undo history allows us to process" );
+   FC_DECLARE_DERIVED_EXCEPTION( unlinkable_block,                      bts::net::net_exception, 90005, "block does not link to a known block yet, and is held until it does" );
 
 } }
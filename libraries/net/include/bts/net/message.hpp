@@ -6,6 +6,8 @@
 #include <fc/crypto/ripemd160.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <memory>
+
 namespace bts { namespace net {
 
   /**
@@ -22,13 +24,53 @@ namespace bts { namespace net {
 
   typedef fc::uint160_t message_hash_type;
 
+  /**
+   *  Reference-counted storage for the body of a message.  Copying a message (to cache it, queue it
+   *  for other peers, etc.) shares the body instead of copying it.  Bodies received from the network
+   *  are drawn from a small pool of buffers and returned to it when the last message referring to
+   *  them goes away, so a busy connection doesn't allocate a fresh buffer for every message.
+   *
+   *  Writing through mutable_data() or resize() first detaches the body from any other messages
+   *  sharing it.
+   */
+  class message_buffer
+  {
+     public:
+        message_buffer(){}
+        message_buffer( std::vector<char>&& bytes )
+        :_bytes( std::make_shared<std::vector<char>>( std::move(bytes) ) ){}
+
+        /** @return a pooled buffer of the given size; its contents are unspecified */
+        static message_buffer allocate( size_t size );
+
+        const char* data()const  { return _bytes ? _bytes->data() : nullptr; }
+        size_t      size()const  { return _bytes ? _bytes->size() : 0; }
+        bool        empty()const { return size() == 0; }
+        const char* begin()const { return data(); }
+        const char* end()const   { return data() + size(); }
+
+        char*       mutable_data();
+        void        resize( size_t new_size );
+
+        /**
+         *  @return a pointer to the start of the body which keeps the body alive while it is held, for
+         *  fc's asynchronous socket reads
+         */
+        std::shared_ptr<char> shared_data();
+
+     private:
+        void detach();
+
+        std::shared_ptr<std::vector<char>> _bytes;
+  };
+
   /**
    *  Abstracts the process of packing/unpacking a message for a 
    *  particular channel.
    */
   struct message : public message_header
   {
-     std::vector<char> data;
+     message_buffer data;
 
      message(){}
 
@@ -45,7 +87,7 @@ namespace bts { namespace net {
      message( const T& m ) 
      {
         msg_type = T::type;
-        data     = fc::raw::pack(m);
+        data     = message_buffer( fc::raw::pack(m) );
         size     = (uint32_t)data.size();
      }
 
@@ -90,5 +132,34 @@ namespace bts { namespace net {
 
 } } // bts::net
 
+namespace fc {
+   namespace raw {
+      template<typename Stream>
+      inline void pack( Stream& s, const bts::net::message_buffer& b )
+      {
+         fc::raw::pack( s, unsigned_int( (uint32_t)b.size() ) );
+         if( b.size() )
+            s.write( b.data(), b.size() );
+      }
+      template<typename Stream>
+      inline void unpack( Stream& s, bts::net::message_buffer& b )
+      {
+         unsigned_int size;
+         fc::raw::unpack( s, size );
+         b = bts::net::message_buffer::allocate( size.value );
+         if( size.value )
+            s.read( b.mutable_data(), size.value );
+      }
+   }
+   inline void to_variant( const bts::net::message_buffer& b, fc::variant& v )
+   {
+      to_variant( std::vector<char>( b.begin(), b.end() ), v );
+   }
+   inline void from_variant( const fc::variant& v, bts::net::message_buffer& b )
+   {
+      b = bts::net::message_buffer( v.as<std::vector<char>>() );
+   }
+}
+
 FC_REFLECT( bts::net::message_header, (size)(msg_type) )
 FC_REFLECT_DERIVED( bts::net::message, (bts::net::message_header), (data) )
@@ -0,0 +1,146 @@
+#include <bts/net/message.hpp>
+#include <bts/net/config.hpp>
+
+#include <mutex>
+
+namespace bts { namespace net {
+
+  namespace detail
+  {
+    /**
+     *  Idle message bodies waiting to be reused.  Bodies may be released from any thread that ended
+     *  up holding the last copy of a message, so the free lists are guarded by a mutex; it is never
+     *  held across anything that could yield.
+     *
+     *  Bodies are kept in size classes so that a small message never pins a buffer sized for a large
+     *  one: short of the smallest class, a body is never handed out for a message less than a quarter
+     *  of its capacity.
+     */
+    class message_buffer_pool
+    {
+    public:
+      message_buffer_pool()
+        : _free( class_for_size( BTS_NET_MESSAGE_BUFFER_POOL_MAX_BUFFER_SIZE ) + 1 )
+      {}
+
+      std::shared_ptr<std::vector<char>> acquire( size_t size )
+      {
+        const size_t size_class = class_for_size( size );
+        std::unique_ptr<std::vector<char>> bytes;
+        if( size_class < _free.size() )
+        {
+          std::lock_guard<std::mutex> lock( _mutex );
+          auto& free = _free[size_class];
+          if( !free.empty() )
+          {
+            bytes = std::move( free.back() );
+            free.pop_back();
+            _idle_bytes -= bytes->capacity();
+          }
+        }
+        if( !bytes )
+        {
+          bytes.reset( new std::vector<char> );
+          // allocate the whole class, so the body can return to it
+          if( size_class < _free.size() )
+            bytes->reserve( class_capacity( size_class ) );
+        }
+        // only bytes beyond the buffer's previous size are initialized here
+        bytes->resize( size );
+        return std::shared_ptr<std::vector<char>>( bytes.release(), [this]( std::vector<char>* b ){ release( b ); } );
+      }
+
+    private:
+      static size_t class_capacity( size_t size_class )
+      {
+        return size_t( BTS_NET_MESSAGE_BUFFER_POOL_MIN_BUFFER_SIZE ) << size_class;
+      }
+
+      /// the smallest class whose bodies can hold size bytes
+      static size_t class_for_size( size_t size )
+      {
+        size_t size_class = 0;
+        while( class_capacity( size_class ) < size )
+          ++size_class;
+        return size_class;
+      }
+
+      void release( std::vector<char>* bytes )
+      {
+        std::unique_ptr<std::vector<char>> owned( bytes );
+        const size_t capacity = owned->capacity();
+        if( capacity < BTS_NET_MESSAGE_BUFFER_POOL_MIN_BUFFER_SIZE || capacity > BTS_NET_MESSAGE_BUFFER_POOL_MAX_BUFFER_SIZE )
+          return;
+        // the largest class the body can serve, which a body that has grown since it was acquired may have left
+        size_t size_class = class_for_size( capacity );
+        if( class_capacity( size_class ) > capacity )
+          --size_class;
+
+        std::lock_guard<std::mutex> lock( _mutex );
+        auto& free = _free[size_class];
+        if( free.size() < BTS_NET_MESSAGE_BUFFER_POOL_SIZE &&
+            _idle_bytes + capacity <= BTS_NET_MESSAGE_BUFFER_POOL_MAX_IDLE_SIZE )
+        {
+          free.push_back( std::move( owned ) );
+          _idle_bytes += capacity;
+        }
+      }
+
+      std::mutex                                                   _mutex;
+      /// idle bodies by size class; those in class i hold at least class_capacity(i) bytes, but fewer than twice that
+      std::vector<std::vector<std::unique_ptr<std::vector<char>>>> _free;
+      size_t                                                       _idle_bytes = 0;
+    };
+
+    message_buffer_pool& get_message_buffer_pool()
+    {
+      // deliberately leaked so that messages destroyed during static destruction can still return their bodies
+      static message_buffer_pool* pool = new message_buffer_pool;
+      return *pool;
+    }
+  }
+
+  message_buffer message_buffer::allocate( size_t size )
+  {
+    message_buffer result;
+    result._bytes = detail::get_message_buffer_pool().acquire( size );
+    return result;
+  }
+
+  char* message_buffer::mutable_data()
+  {
+    detach();
+    return _bytes ? _bytes->data() : nullptr;
+  }
+
+  void message_buffer::resize( size_t new_size )
+  {
+    if( !_bytes )
+    {
+      *this = allocate( new_size );
+      return;
+    }
+    detach();
+    _bytes->resize( new_size );
+  }
+
+  std::shared_ptr<char> message_buffer::shared_data()
+  {
+    detach();
+    if( !_bytes )
+      return std::shared_ptr<char>();
+    // aliasing constructor: shares ownership of the body while pointing at its bytes
+    return std::shared_ptr<char>( _bytes, _bytes->data() );
+  }
+
+  void message_buffer::detach()
+  {
+    if( _bytes && !_bytes.unique() )
+    {
+      auto copy = allocate( _bytes->size() );
+      std::copy( _bytes->begin(), _bytes->end(), copy._bytes->begin() );
+      _bytes = std::move( copy._bytes );
+    }
+  }
+
+} } // bts::net
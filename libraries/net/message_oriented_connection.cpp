@@ -129,24 +129,30 @@ namespace bts { namespace net {
 
       try
       {
-        message m;
         while( true )
         {
           char buffer[BUFFER_SIZE];
           _sock.read(buffer, BUFFER_SIZE);
           _bytes_received += BUFFER_SIZE;
-          memcpy((char*)&m, buffer, sizeof(message_header));
+
+          // the body is handed to the delegate by reference and may be kept (cached, queued for other
+          // peers) without being copied, so each message gets its own pooled body
+          message m;
+          memcpy(static_cast<message_header*>(&m), buffer, sizeof(message_header));
 
           FC_ASSERT( m.size <= MAX_MESSAGE_SIZE, "", ("m.size",m.size)("MAX_MESSAGE_SIZE",MAX_MESSAGE_SIZE) );
 
           size_t remaining_bytes_with_padding = 16 * ((m.size - LEFTOVER + 15) / 16);
-          m.data.resize(LEFTOVER + remaining_bytes_with_padding); //give extra 16 bytes to allow for padding added in send call
-          std::copy(buffer + sizeof(message_header), buffer + sizeof(buffer), m.data.begin());
+          m.data = message_buffer::allocate(LEFTOVER + remaining_bytes_with_padding); //give extra 16 bytes to allow for padding added in send call
+          std::shared_ptr<char> body = m.data.shared_data();
+          std::copy(buffer + sizeof(message_header), buffer + sizeof(buffer), body.get());
           if (remaining_bytes_with_padding)
           {
-            _sock.read(&m.data[LEFTOVER], remaining_bytes_with_padding);
+            // decrypted in place, straight into the message body
+            _sock.read(body, remaining_bytes_with_padding, LEFTOVER);
             _bytes_received += remaining_bytes_with_padding;
           }
+          body.reset();
           m.data.resize(m.size); // truncate off the padding bytes
 
           _last_message_received_time = fc::time_point::now();
@@ -2755,6 +2755,7 @@ namespace bts { namespace net { namespace detail {
       dlog("in send_sync_block_to_node_delegate()");
       bool client_accepted_block = false;
       bool discontinue_fetching_blocks_from_peer = false;
+      bool block_held_unlinked = false;
 
       fc::oexception handle_message_exception;
 
@@ -2768,6 +2769,15 @@ namespace bts { namespace net { namespace detail {
 
         client_accepted_block = true;
       }
+      catch (const unlinkable_block& e)
+      {
+        // the client holds the block until it can link it; the peer is not at fault for sending it
+        wlog("Sync block ${num} (id:${id}) does not link to our chain yet; the client is holding it",
+             ("num", block_message_to_send.block.block_num())
+             ("id", block_message_to_send.block_id));
+        handle_message_exception = e;
+        block_held_unlinked = true;
+      }
       catch (const block_older_than_undo_history& e)
       {
         wlog("Failed to push sync block ${num} (id:${id}): block is on a fork older than our undo history would "
@@ -2889,7 +2899,7 @@ namespace bts { namespace net { namespace detail {
                    ("endpoint", peer->get_remote_endpoint()));
               peer->inhibit_fetching_sync_blocks = true;
             }
-            else
+            else if (!block_held_unlinked)
               peers_to_disconnect[peer] = std::make_pair(std::string("You offered us a block that we reject as invalid"), fc::oexception(handle_message_exception));
           }
         }
@@ -3148,6 +3158,15 @@ namespace bts { namespace net { namespace detail {
       {
         throw;
       }
+      catch (const unlinkable_block& e)
+      {
+        // the client holds the block until its previous block arrives.  It has not been validated, so it is not
+        // relayed, but neither is it invalid, so the peers that offered it are not disconnected
+        wlog("Block ${num} (id:${id}) does not link to our chain yet; the client is holding it: ${e}",
+             ("num", block_message_to_process.block.block_num())
+             ("id", block_message_to_process.block_id)
+             ("e", e.to_string()));
+      }
       catch ( const fc::exception& e )
       {
         // client rejected the block.  Disconnect the client and any other clients that offered us this block
@@ -1,7 +1,10 @@
 
 #include <bts/account_history/account_history_plugin.hpp>
 
+#include <bts/app/application.hpp>
+
 #include <bts/chain/account_evaluator.hpp>
+#include <bts/chain/account_history_store.hpp>
 #include <bts/chain/account_object.hpp>
 #include <bts/chain/config.hpp>
 #include <bts/chain/database.hpp>
@@ -10,6 +13,7 @@
 #include <bts/chain/operation_history_object.hpp>
 #include <bts/chain/transaction_evaluation_state.hpp>
 
+#include <fc/filesystem.hpp>
 #include <fc/thread/thread.hpp>
 
 namespace bts { namespace account_history {
@@ -98,6 +102,10 @@ class account_history_plugin_impl
       account_create_observer _create_observer;
       account_update_observer _update_observer;
       flat_set<account_id_type> _tracked_accounts;
+
+      /** holds the history store when the application has no data directory, e.g. in unit tests */
+      optional<fc::temp_directory>           _temp_history_dir;
+      std::shared_ptr<account_history_store> _history_store;
 };
 
 struct operation_get_impacted_accounts
@@ -514,36 +522,25 @@ void account_history_plugin_impl::update_account_histories( const signed_block&
 {
    bts::chain::database& db = database();
    const vector<operation_history_object>& hist = db.get_applied_operations();
-   for( auto op : hist )
+
+   vector<account_history_store::applied_operation> applied;
+   applied.resize( hist.size() );
+   for( size_t i = 0; i < hist.size(); ++i )
    {
-      // add to the operation history index
-      const auto& oho = db.create<operation_history_object>( [&]( operation_history_object& h ){
-                                h = op;
-                        });
+      const operation_history_object& op = hist[i];
+      applied[i].op = op;
 
       // get the set of accounts this operation applies to
       flat_set<account_id_type> impacted;
       op.op.visit( operation_get_required_auths( impacted, impacted ) );
-      op.op.visit( operation_get_impacted_accounts( oho, _self, impacted ) );
+      op.op.visit( operation_get_impacted_accounts( op, _self, impacted ) );
 
       // for each operation this account applies to that is in the config link it into the history
       if( _tracked_accounts.size() == 0 )
       {
-         for( auto& account_id : impacted )
-         {
-            // we don't do index_account_keys here anymore, because
-            // that indexing now happens in observers' post_evaluate()
-
-            // add history
-            const auto& stats_obj = account_id(db).statistics(db);
-            const auto& ath = db.create<account_transaction_history_object>( [&]( account_transaction_history_object& obj ){
-                obj.operation_id = oho.id;
-                obj.next = stats_obj.most_recent_op;
-            });
-            db.modify( stats_obj, [&]( account_statistics_object& obj ){
-                obj.most_recent_op = ath.id;
-            });
-         }
+         // we don't do index_account_keys here anymore, because
+         // that indexing now happens in observers' post_evaluate()
+         applied[i].accounts = std::move( impacted );
       }
       else
       {
@@ -552,20 +549,13 @@ void account_history_plugin_impl::update_account_histories( const signed_block&
             if( impacted.find( account_id ) != impacted.end() )
             {
                index_account_keys( account_id );
-
-               // add history
-               const auto& stats_obj = account_id(db).statistics(db);
-               const auto& ath = db.create<account_transaction_history_object>( [&]( account_transaction_history_object& obj ){
-                   obj.operation_id = oho.id;
-                   obj.next = stats_obj.most_recent_op;
-               });
-               db.modify( stats_obj, [&]( account_statistics_object& obj ){
-                   obj.most_recent_op = ath.id;
-               });
+               applied[i].accounts.insert( account_id );
             }
          }
       }
    }
+
+   _history_store->store_block( b.block_num(), applied );
 }
 } // end namespace detail
 
@@ -590,6 +580,9 @@ void account_history_plugin::plugin_set_program_options(
 {
    cli.add_options()
          ("track-account", bpo::value<std::vector<std::string>>()->composing()->multitoken(), "Account ID to track history for (may specify multiple times)")
+         ("history-max-ops-per-account", bpo::value<uint32_t>()->default_value(0), "Number of most recent operations to keep in each account's history (0 keeps all)")
+         ("history-max-age", bpo::value<uint32_t>()->default_value(0), "Number of most recent blocks to keep account history for (0 keeps all)")
+         ("history-cache-size", bpo::value<uint32_t>()->default_value(16), "Megabytes of account history to cache in memory")
          ;
    cfg.add(cli);
 }
@@ -597,14 +590,31 @@ void account_history_plugin::plugin_set_program_options(
 void account_history_plugin::plugin_initialize(const boost::program_options::variables_map& options)
 {
    database().applied_block.connect( [&]( const signed_block& b){ my->update_account_histories(b); } );
-   database().add_index< primary_index< simple_index< operation_history_object > > >();
-   database().add_index< primary_index< simple_index< account_transaction_history_object > > >();
    database().add_index< primary_index< key_account_index >>();
 
    database().register_evaluation_observer<account_create_evaluator>( my->_create_observer );
    database().register_evaluation_observer< bts::chain::account_update_evaluator >( my->_update_observer );
 
-   LOAD_VALUE_SET(options, "tracked-accounts", my->_tracked_accounts, bts::chain::account_id_type);
+   LOAD_VALUE_SET(options, "track-account", my->_tracked_accounts, bts::chain::account_id_type);
+
+   // The store must be open before the application opens the chain database, which may replay blocks.
+   fc::path history_dir = app().data_dir();
+   if( history_dir == fc::path() )
+   {
+      my->_temp_history_dir = fc::temp_directory();
+      history_dir = my->_temp_history_dir->path();
+   }
+   size_t cache_size = 16;
+   if( options.count("history-cache-size") )
+      cache_size = options["history-cache-size"].as<uint32_t>();
+
+   my->_history_store = std::make_shared<account_history_store>();
+   my->_history_store->open( history_dir / "account_history", cache_size * 1024 * 1024 );
+   if( options.count("history-max-ops-per-account") )
+      my->_history_store->set_max_ops_per_account( options["history-max-ops-per-account"].as<uint32_t>() );
+   if( options.count("history-max-age") )
+      my->_history_store->set_max_age( options["history-max-age"].as<uint32_t>() );
+   database().set_account_history_store( my->_history_store );
 }
 
 void account_history_plugin::plugin_startup()
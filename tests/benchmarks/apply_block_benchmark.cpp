@@ -0,0 +1,253 @@
+#include <bts/account_history/account_history_plugin.hpp>
+
+#include <bts/chain/database.hpp>
+#include <bts/chain/operations.hpp>
+#include <bts/chain/account_object.hpp>
+#include <bts/chain/asset_object.hpp>
+#include <bts/chain/key_object.hpp>
+
+#include <fc/crypto/digest.hpp>
+#include <fc/io/raw.hpp>
+
+#include <boost/program_options.hpp>
+#include <boost/test/auto_unit_test.hpp>
+
+#include <random>
+
+using namespace bts::chain;
+
+namespace {
+
+/// Time spent in each phase of pushing the measured blocks
+struct push_block_timings
+{
+   fc::microseconds total;
+   fc::microseconds signatures;
+   fc::microseconds applied_block;
+};
+
+/**
+ * Pushes setup_blocks untimed, then workload_blocks timed, into a fresh database with the account history plugin
+ * subscribed to applied_block.  When track_undo is false, undo tracking is switched off around each timed push_block,
+ * so comparing the two runs gives the cost of recording undo state.
+ */
+push_block_timings replay_blocks( const genesis_allocation& allocation,
+                                  const vector<signed_block>& setup_blocks,
+                                  const vector<signed_block>& workload_blocks,
+                                  bool track_undo )
+{
+   fc::temp_directory data_dir(fc::current_path());
+   bts::app::application app;
+   auto ahplugin = app.register_plugin<bts::account_history::account_history_plugin>();
+   boost::program_options::variables_map options;
+   ahplugin->plugin_initialize( options );
+
+   database& db = *app.chain_database();
+   db.open(data_dir.path(), allocation);
+   ahplugin->plugin_startup();
+
+   for( const auto& b : setup_blocks )
+      db.push_block( b );
+
+   push_block_timings result;
+   fc::time_point signal_start;
+   auto first_slot = db.applied_block.connect( [&]( const signed_block& ) {
+      signal_start = fc::time_point::now();
+   }, boost::signals2::at_front );
+   auto last_slot = db.applied_block.connect( [&]( const signed_block& ) {
+      result.applied_block += fc::time_point::now() - signal_start;
+   }, boost::signals2::at_back );
+
+   for( const auto& b : workload_blocks )
+   {
+      // Round-trip through the wire format so that no signature caches survive from the producing database
+      signed_block fresh = fc::raw::unpack<signed_block>( fc::raw::pack( b ) );
+
+      // push_block doesn't recover signatures of transactions in a block, but every node did so when the transaction
+      // was first broadcast, so time it here
+      auto start_time = fc::time_point::now();
+      for( const auto& trx : fresh.transactions )
+         trx.get_signature_addresses( trx.digest() );
+      result.signatures += fc::time_point::now() - start_time;
+
+      if( !track_undo ) db._undo_db.disable();
+      start_time = fc::time_point::now();
+      db.push_block( fresh );
+      result.total += fc::time_point::now() - start_time;
+      if( !track_undo ) db._undo_db.enable();
+   }
+
+   first_slot.disconnect();
+   last_slot.disconnect();
+   db.close();
+   return result;
+}
+
+}
+
+/**
+ * Measures database::push_block on a deterministic chain of blocks carrying a mix of transfers, crossing limit orders,
+ * account creations and proposals.  Every random choice is drawn from a fixed seed, so runs on different commits apply
+ * exactly the same blocks and their timings can be compared directly.
+ */
+BOOST_AUTO_TEST_CASE( apply_block_bench )
+{
+   try {
+#ifdef NDEBUG
+      ilog("Running in release mode.");
+      const int account_count = 20000;
+      const int trader_count = 2000;
+      const int block_count = 500;
+      const int transactions_per_block = 200;
+#else
+      ilog("Running in debug mode.");
+      const int account_count = 1000;
+      const int trader_count = 100;
+      const int block_count = 30;
+      const int transactions_per_block = 50;
+#endif
+
+      genesis_allocation allocation;
+      vector<fc::ecc::private_key> account_keys;
+      for( int i = 0; i < account_count; ++i )
+      {
+         account_keys.push_back(fc::ecc::private_key::regenerate(fc::digest(i)));
+         allocation.emplace_back(public_key_type(account_keys.back().get_public_key()), BTS_INITIAL_SUPPLY / account_count);
+      }
+      auto genesis_private_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("genesis")));
+
+      vector<signed_block> setup_blocks;
+      vector<signed_block> workload_blocks;
+      uint32_t workload_transactions = 0;
+      {
+         fc::temp_directory data_dir(fc::current_path());
+         database db;
+         db.open(data_dir.path(), allocation);
+
+         const uint32_t skip = database::skip_transaction_signatures;
+         const account_id_type registrar(1);
+         auto signing_key_id = [&]( account_id_type a ) -> key_id_type {
+            return a(db).active.auths.begin()->first;
+         };
+         auto sign_and_push = [&]( signed_transaction& trx, account_id_type signer, const fc::ecc::private_key& key ) -> bool {
+            trx.set_expiration( db.head_block_time() + fc::minutes(1) );
+            trx.sign( signing_key_id( signer ), key );
+            try {
+               db.push_transaction( trx, skip );
+               return true;
+            } catch( const fc::exception& ) {
+               // e.g. a duplicate of an earlier transaction; the seed is fixed, so the same ones are dropped every run
+               return false;
+            }
+         };
+         auto generate_block = [&]() -> signed_block {
+            auto now = db.head_block_time() + db.block_interval();
+            return db.generate_block( now, db.get_scheduled_witness( now )->second, genesis_private_key, skip );
+         };
+
+         // Setup: a user issued asset to trade against, held by the first trader_count accounts
+         signed_transaction trx;
+         asset_create_operation creator;
+         creator.issuer = registrar;
+         creator.symbol = "BENCH";
+         creator.precision = 2;
+         creator.common_options.max_supply = BTS_MAX_SHARE_SUPPLY;
+         creator.common_options.core_exchange_rate = price({asset(1,1),asset(1)});
+         trx.operations.push_back(creator);
+         FC_ASSERT( sign_and_push( trx, registrar, genesis_private_key ) );
+         setup_blocks.push_back( generate_block() );
+         const asset_id_type bench_asset = db.get_index_type<asset_index>().indices().get<by_symbol>().find("BENCH")->id;
+
+         for( int i = 0; i < trader_count; ++i )
+         {
+            trx = signed_transaction();
+            trx.operations.push_back(asset_issue_operation({asset(), registrar, asset(1000000000, bench_asset), account_id_type(i + 11)}));
+            FC_ASSERT( sign_and_push( trx, registrar, genesis_private_key ) );
+         }
+         setup_blocks.push_back( generate_block() );
+
+         std::mt19937 rng(1337);
+         uint32_t new_accounts = 0;
+         for( int b = 0; b < block_count; ++b )
+         {
+            for( int t = 0; t < transactions_per_block; ++t )
+            {
+               trx = signed_transaction();
+               int from = rng() % account_count;
+               int to = rng() % account_count;
+               uint32_t kind = rng() % 100;
+               bool pushed = false;
+               if( kind < 60 )
+               {
+                  trx.operations.push_back(transfer_operation({asset(), account_id_type(from + 11), account_id_type(to + 11),
+                                                               asset(1 + rng() % 1000), memo_data()}));
+                  pushed = sign_and_push( trx, account_id_type(from + 11), account_keys[from] );
+               }
+               else if( kind < 80 )
+               {
+                  // Both sides of the book at the same price, so most orders fill against an earlier one
+                  int trader = rng() % trader_count;
+                  int64_t amount = 1 + rng() % 10000;
+                  limit_order_create_operation op;
+                  op.seller = account_id_type(trader + 11);
+                  if( rng() % 2 )
+                  {
+                     op.amount_to_sell = asset(amount);
+                     op.min_to_receive = asset(amount, bench_asset);
+                  }
+                  else
+                  {
+                     op.amount_to_sell = asset(amount, bench_asset);
+                     op.min_to_receive = asset(amount);
+                  }
+                  trx.operations.push_back(op);
+                  pushed = sign_and_push( trx, op.seller, account_keys[trader] );
+               }
+               else if( kind < 90 )
+               {
+                  auto key = fc::ecc::private_key::regenerate(fc::digest(account_count + new_accounts));
+                  trx.operations.push_back(key_create_operation({asset(), registrar, public_key_type(key.get_public_key())}));
+                  relative_key_id_type key_id(0);
+                  account_create_operation cop;
+                  cop.name = "bench-account-" + fc::to_string(new_accounts++);
+                  cop.registrar = registrar;
+                  cop.active = authority(1, key_id, 1);
+                  cop.owner = cop.active;
+                  cop.memo_key = key_id;
+                  trx.operations.push_back(cop);
+                  pushed = sign_and_push( trx, registrar, genesis_private_key );
+               }
+               else
+               {
+                  proposal_create_operation op;
+                  op.fee_paying_account = account_id_type(from + 11);
+                  op.proposed_ops.push_back({transfer_operation({asset(), account_id_type(from + 11), account_id_type(to + 11),
+                                                                 asset(1 + rng() % 1000), memo_data()})});
+                  op.expiration_time = db.head_block_time() + fc::hours(1);
+                  trx.operations.push_back(op);
+                  pushed = sign_and_push( trx, op.fee_paying_account, account_keys[from] );
+               }
+               workload_transactions += pushed;
+            }
+            workload_blocks.push_back( generate_block() );
+         }
+         db.close();
+      }
+      ilog("Generated ${b} blocks with ${t} transactions.", ("b", workload_blocks.size())("t", workload_transactions));
+
+      auto with_undo = replay_blocks( allocation, setup_blocks, workload_blocks, true );
+      auto without_undo = replay_blocks( allocation, setup_blocks, workload_blocks, false );
+
+      auto ms = []( fc::microseconds t ) { return t.count() / 1000; };
+      ilog("push_block: ${t} ms for ${b} blocks, ${tps} transactions per second",
+           ("t", ms(with_undo.total))("b", workload_blocks.size())
+           ("tps", with_undo.total.count() ? workload_transactions * 1000000ll / with_undo.total.count() : 0));
+      ilog("  signature recovery: ${t} ms", ("t", ms(with_undo.signatures)));
+      ilog("  evaluation:         ${t} ms", ("t", ms(without_undo.total - without_undo.applied_block)));
+      ilog("  undo tracking:      ${t} ms", ("t", ms(with_undo.total - without_undo.total)));
+      ilog("  applied_block:      ${t} ms", ("t", ms(with_undo.applied_block)));
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
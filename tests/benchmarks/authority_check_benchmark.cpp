@@ -0,0 +1,167 @@
+#include <bts/chain/database.hpp>
+#include <bts/chain/operations.hpp>
+#include <bts/chain/account_object.hpp>
+
+#include <fc/crypto/digest.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace bts::chain;
+
+namespace {
+
+/// Makes the owner and active authorities of parent require every one of children
+void require_all( database& db, account_id_type parent, const vector<account_id_type>& children )
+{
+   db.modify( parent(db), [&]( account_object& a ) {
+      a.active = authority();
+      for( const auto& child : children )
+         a.active.add_authority( child, 1 );
+      a.active.weight_threshold = children.size();
+      a.owner = a.active;
+   });
+}
+
+/// @return every key in the authority tree of account, which signing together satisfy authorities made by require_all()
+vector<key_id_type> leaf_keys( database& db, account_id_type account )
+{
+   const account_object& a = account(db);
+   vector<key_id_type> keys;
+   for( const auto& auth : a.active.auths )
+   {
+      if( auth.first.type() == account_object_type )
+      {
+         auto child_keys = leaf_keys( db, account_id_type(auth.first) );
+         keys.insert( keys.end(), child_keys.begin(), child_keys.end() );
+      }
+      else
+         keys.push_back( key_id_type(auth.first) );
+   }
+   return keys;
+}
+
+/**
+ * Pushes trx_count transfers from account, each signed by the keys its authority needs, first resolving the
+ * authority afresh for every transaction and then with the block's authority cache.
+ */
+void time_transfers( database& db, const string& shape, account_id_type account, int trx_count )
+{
+   signed_transaction trx;
+   trx.operations.push_back( transfer_operation({asset(), account, account_id_type(), asset(1)}) );
+   // signatures are not verified in this benchmark, only matched against the authorities
+   for( const auto& key : leaf_keys( db, account ) )
+      trx.signatures[key] = signature_type();
+   const uint32_t skip = ~0 & ~database::skip_authority_check;
+
+   auto start_time = fc::time_point::now();
+   for( int i = 0; i < trx_count; ++i )
+   {
+      db.get_authority_cache().clear();
+      db.push_transaction( trx, skip );
+   }
+   auto uncached = fc::time_point::now() - start_time;
+   db.clear_pending();
+
+   start_time = fc::time_point::now();
+   for( int i = 0; i < trx_count; ++i )
+      db.push_transaction( trx, skip );
+   auto cached = fc::time_point::now() - start_time;
+   db.clear_pending();
+
+   ilog("${s}, ${k} keys: ${u} microseconds per transaction resolving each authority, ${c} with the cache.",
+        ("s", shape)("k", trx.signatures.size())
+        ("u", uncached.count() / trx_count)("c", cached.count() / trx_count));
+}
+
+}
+
+BOOST_AUTO_TEST_CASE( authority_check_bench )
+{
+   try {
+#ifdef NDEBUG
+      ilog("Running in release mode.");
+      const int trx_count = 20000;
+#else
+      ilog("Running in debug mode.");
+      const int trx_count = 2000;
+#endif
+      const int account_count = 100;
+
+      genesis_allocation allocation;
+      for( int i = 0; i < account_count; ++i )
+         allocation.emplace_back(public_key_type(fc::ecc::private_key::regenerate(fc::digest(i)).get_public_key()),
+                                 BTS_INITIAL_SUPPLY / account_count);
+
+      fc::temp_directory data_dir(fc::current_path());
+      database db;
+      db.open(data_dir.path(), allocation);
+
+      // Accounts 11 onwards each hold one of the allocated keys; arrange some of them into multisig hierarchies
+      uint64_t next_account = 11;
+      auto take = [&]() -> account_id_type { return account_id_type(next_account++); };
+      auto take_accounts = [&]( int count ) -> vector<account_id_type> {
+         vector<account_id_type> accounts;
+         for( int i = 0; i < count; ++i )
+            accounts.push_back( take() );
+         return accounts;
+      };
+      auto own_key = [&]( account_id_type a ) {
+         db.modify( a(db), [&]( account_object& acct ) {
+            acct.active = authority( 1, acct.memo_key, 1 );
+            acct.owner = acct.active;
+         });
+      };
+
+      db._undo_db.disable();
+
+      // one account requiring ten keys
+      account_id_type wide = take();
+      {
+         auto holders = take_accounts( 10 );
+         db.modify( wide(db), [&]( account_object& a ) {
+            a.active = authority();
+            for( const auto& holder : holders )
+               a.active.add_authority( holder(db).memo_key, 1 );
+            a.active.weight_threshold = holders.size();
+            a.owner = a.active;
+         });
+      }
+
+      // a chain of accounts as deep as authorities are followed
+      account_id_type deep = take();
+      {
+         account_id_type parent = deep;
+         for( int depth = 0; depth < BTS_MAX_SIG_CHECK_DEPTH; ++depth )
+         {
+            account_id_type child = take();
+            require_all( db, parent, {child} );
+            parent = child;
+         }
+         own_key( parent );
+      }
+
+      // four accounts of four accounts, each requiring its own key
+      account_id_type tree = take();
+      {
+         vector<account_id_type> children = take_accounts( 4 );
+         require_all( db, tree, children );
+         for( const auto& child : children )
+         {
+            vector<account_id_type> grandchildren = take_accounts( 4 );
+            require_all( db, child, grandchildren );
+            for( const auto& grandchild : grandchildren )
+               own_key( grandchild );
+         }
+      }
+      FC_ASSERT( next_account <= 11 + account_count );
+
+      db._undo_db.enable();
+
+      time_transfers( db, "Wide", wide, trx_count );
+      time_transfers( db, "Deep", deep, trx_count );
+      time_transfers( db, "Deep and wide", tree, trx_count );
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
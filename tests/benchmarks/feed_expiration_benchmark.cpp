@@ -0,0 +1,108 @@
+#include <bts/chain/database.hpp>
+#include <bts/chain/operations.hpp>
+#include <bts/chain/asset_object.hpp>
+
+#include <fc/crypto/digest.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace bts::chain;
+
+namespace {
+
+/**
+ * Creates bitasset_count bitassets, each with one feed.  The feeds of the first expiring_per_block * block_count of
+ * them expire expiring_per_block to a block over the measured blocks; the rest stay current throughout.
+ *
+ * @return the average time taken to generate a block
+ */
+fc::microseconds time_blocks_with_bitassets( int bitasset_count, int block_count, int expiring_per_block )
+{
+   fc::temp_directory data_dir(fc::current_path());
+   database db;
+   db.open(data_dir.path());
+   auto delegate_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("genesis")) );
+
+   for( int i = 0; i < bitasset_count; ++i )
+   {
+      asset_create_operation creator;
+      creator.issuer = account_id_type(1);
+      creator.symbol = "FEED";
+      for( int n = i, c = 0; c < 4; ++c, n /= 26 )
+         creator.symbol += char('A' + n % 26);
+      creator.precision = 2;
+      creator.common_options.max_supply = BTS_MAX_SHARE_SUPPLY;
+      creator.common_options.issuer_permissions = market_issued;
+      creator.common_options.flags = market_issued;
+      creator.common_options.core_exchange_rate = price({asset(1,1),asset(1)});
+      creator.bitasset_options = asset_object::bitasset_options();
+      signed_transaction trx;
+      trx.operations.push_back(creator);
+      db.push_transaction(trx, ~0);
+   }
+   auto now = db.head_block_time() + db.block_interval();
+   db.generate_block( now, db.get_scheduled_witness( now )->second, delegate_priv_key, ~0 );
+
+   db._undo_db.disable();
+   int i = 0;
+   for( const asset_bitasset_data_object& b : db.get_index_type<asset_bitasset_data_index>().indices() )
+   {
+      auto published = db.head_block_time();
+      if( i < expiring_per_block * block_count )
+         published = published - b.options.feed_lifetime_sec + db.block_interval() * (i / expiring_per_block + 1);
+      db.modify( b, [&]( asset_bitasset_data_object& a ) {
+         a.feeds[account_id_type(1)] = std::make_pair( published, price_feed() );
+         a.update_median_feeds( db.head_block_time() );
+      });
+      ++i;
+   }
+   db._undo_db.enable();
+
+   auto start_time = fc::time_point::now();
+   for( int b = 0; b < block_count; ++b )
+   {
+      now = db.head_block_time() + db.block_interval();
+      db.generate_block( now, db.get_scheduled_witness( now )->second, delegate_priv_key, ~0 );
+   }
+   auto elapsed = fc::time_point::now() - start_time;
+
+   // every feed which was due to expire has been dropped
+   i = 0;
+   for( const asset_bitasset_data_object& b : db.get_index_type<asset_bitasset_data_index>().indices() )
+      i += b.current_feed_publication_time > db.head_block_time() - b.options.feed_lifetime_sec;
+   FC_ASSERT( i == bitasset_count );
+
+   db.close();
+   return fc::microseconds( elapsed.count() / block_count );
+}
+
+}
+
+/**
+ * Blocks in which a fixed number of feeds expire should take the same time however many bitassets there are.
+ */
+BOOST_AUTO_TEST_CASE( feed_expiration_bench )
+{
+   try {
+#ifdef NDEBUG
+      ilog("Running in release mode.");
+      const int bitasset_count = 20000;
+      const int block_count = 500;
+#else
+      ilog("Running in debug mode.");
+      const int bitasset_count = 2000;
+      const int block_count = 100;
+#endif
+      const int expiring_per_block = 2;
+
+      for( int count : { expiring_per_block * block_count, bitasset_count / 4, bitasset_count } )
+      {
+         auto per_block = time_blocks_with_bitassets( count, block_count, expiring_per_block );
+         ilog("With ${n} bitassets, ${e} feeds expiring per block: ${t} microseconds per block.",
+              ("n", count)("e", expiring_per_block)("t", per_block.count()));
+      }
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -87,6 +87,12 @@ BOOST_AUTO_TEST_CASE( genesis_and_persistence_bench )
          ilog("Pushed ${c} blocks (1 op each, no validation) in ${t} milliseconds.",
               ("c", blocks_out)("t", (fc::time_point::now() - start_time).count() / 1000));
 
+         // Only the objects touched by the blocks above are dirty, so this should be much faster than the first close
+         start_time = fc::time_point::now();
+         db.flush();
+         ilog("Flushed ${c} blocks of changes in ${t} milliseconds.",
+              ("c", blocks_to_produce)("t", (fc::time_point::now() - start_time).count() / 1000));
+
          start_time = fc::time_point::now();
          db.close();
          ilog("Closed database in ${t} milliseconds.", ("t", (fc::time_point::now() - start_time).count() / 1000));
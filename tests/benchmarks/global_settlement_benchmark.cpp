@@ -0,0 +1,139 @@
+#include <bts/chain/database.hpp>
+#include <bts/chain/operations.hpp>
+#include <bts/chain/account_object.hpp>
+#include <bts/chain/asset_object.hpp>
+#include <bts/chain/limit_order_object.hpp>
+#include <bts/chain/short_order_object.hpp>
+
+#include <fc/crypto/digest.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace bts::chain;
+
+namespace {
+
+const asset_object& create_bench_asset( database& db, const string& symbol, bool market_issued )
+{
+   asset_create_operation creator;
+   creator.issuer = account_id_type(1);
+   creator.symbol = symbol;
+   creator.precision = 2;
+   creator.common_options.max_supply = BTS_MAX_SHARE_SUPPLY;
+   creator.common_options.core_exchange_rate = price({asset(1,1),asset(1)});
+   if( market_issued )
+   {
+      creator.common_options.issuer_permissions = market_issued;
+      creator.common_options.flags = market_issued;
+      creator.bitasset_options = asset_object::bitasset_options();
+   }
+   signed_transaction trx;
+   trx.operations.push_back(creator);
+   auto ptx = db.push_transaction(trx, ~0);
+   return db.get<asset_object>(ptx.operation_results[0].get<object_id_type>());
+}
+
+}
+
+/**
+ * Globally settles a bitasset with a call position held by each of position_count accounts, half of which also have an
+ * order selling the bitasset, while an unrelated market holds as many orders again.
+ */
+BOOST_AUTO_TEST_CASE( global_settlement_bench )
+{
+   try {
+#ifdef NDEBUG
+      ilog("Running in release mode.");
+      const int position_count = 100000;
+#else
+      ilog("Running in debug mode.");
+      const int position_count = 10000;
+#endif
+      const share_type debt = 1000;
+      const share_type collateral = 2000;
+
+      genesis_allocation allocation;
+      for( int i = 0; i < position_count; ++i )
+         allocation.emplace_back(public_key_type(fc::ecc::private_key::regenerate(fc::digest(i)).get_public_key()),
+                                 BTS_INITIAL_SUPPLY / position_count);
+
+      fc::temp_directory data_dir(fc::current_path());
+      database db;
+      db.open(data_dir.path(), allocation);
+
+      const asset_object& bitusd = create_bench_asset( db, "BITUSD", true );
+      const asset_object& other = create_bench_asset( db, "OTHER", false );
+      auto delegate_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("genesis")) );
+      auto now = db.head_block_time() + db.block_interval();
+      db.generate_block( now, db.get_scheduled_witness( now )->second, delegate_priv_key, ~0 );
+
+      // Build the positions directly, keeping the supplies consistent so that the settlement's own checks pass
+      auto start_time = fc::time_point::now();
+      db._undo_db.disable();
+      for( int i = 0; i < position_count; ++i )
+      {
+         account_id_type owner(i + 11);
+         db.adjust_balance( owner, asset(-collateral) );
+         db.modify( owner(db).statistics(db), [&]( account_statistics_object& s ) {
+            s.total_core_in_orders += collateral;
+         });
+         db.create<call_order_object>( [&]( call_order_object& call ) {
+            call.borrower = owner;
+            call.collateral = collateral;
+            call.debt = debt;
+            call.maintenance_collateral_ratio = BTS_DEFAULT_MAINTENANCE_COLLATERAL_RATIO;
+            call.call_price = price::max( asset_id_type(), bitusd.id );
+            call.update_call_price();
+         });
+         db.adjust_balance( owner, bitusd.amount(debt) );
+
+         if( i % 2 )
+         {
+            // asks for the bitasset spread over many price levels
+            share_type for_sale = debt / 2;
+            db.adjust_balance( owner, bitusd.amount(-for_sale) );
+            db.create<limit_order_object>( [&]( limit_order_object& o ) {
+               o.seller = owner;
+               o.for_sale = for_sale;
+               o.set_sell_price( bitusd.amount(for_sale) / asset(for_sale + i) );
+               o.expiration = fc::time_point_sec::maximum();
+            });
+         }
+         else
+         {
+            // orders in a market the settlement should not touch
+            share_type for_sale = 10;
+            db.adjust_balance( owner, asset(-for_sale) );
+            db.modify( owner(db).statistics(db), [&]( account_statistics_object& s ) {
+               s.total_core_in_orders += for_sale;
+            });
+            db.create<limit_order_object>( [&]( limit_order_object& o ) {
+               o.seller = owner;
+               o.for_sale = for_sale;
+               o.set_sell_price( asset(for_sale) / other.amount(1 + i) );
+               o.expiration = fc::time_point_sec::maximum();
+            });
+         }
+      }
+      db.modify( bitusd.dynamic_asset_data_id(db), [&]( asset_dynamic_data_object& d ) {
+         d.current_supply += debt * position_count;
+      });
+      db._undo_db.enable();
+      ilog("Created ${n} call positions and ${n} limit orders in ${t} milliseconds.",
+           ("n", position_count)("t", (fc::time_point::now() - start_time).count() / 1000));
+
+      // Settle within an undo session, as happens when a block is applied
+      auto session = db._undo_db.start_undo_session();
+      start_time = fc::time_point::now();
+      db.globally_settle_asset( bitusd, bitusd.amount(1) / asset(1) );
+      auto elapsed = fc::time_point::now() - start_time;
+
+      FC_ASSERT( db.get_index_type<call_order_index>().indices().empty() );
+      FC_ASSERT( db.get_index_type<limit_order_index>().indices().size() == size_t(position_count - position_count / 2) );
+      ilog("Globally settled ${n} call positions and ${o} orders in ${t} milliseconds.",
+           ("n", position_count)("o", position_count / 2)("t", elapsed.count() / 1000));
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -0,0 +1,104 @@
+#include <bts/chain/database.hpp>
+#include <bts/chain/operations.hpp>
+#include <bts/chain/account_object.hpp>
+#include <bts/chain/asset_object.hpp>
+#include <bts/chain/limit_order_object.hpp>
+
+#include <fc/crypto/digest.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace bts::chain;
+
+/**
+ * Places orders against a book with an ask from each of book_depth accounts, each at its own price level: first
+ * orders that do not cross the book, then orders that each fill the best ask.
+ */
+BOOST_AUTO_TEST_CASE( order_matching_bench )
+{
+   try {
+#ifdef NDEBUG
+      ilog("Running in release mode.");
+      const int book_depth = 100000;
+      const int order_count = 10000;
+#else
+      ilog("Running in debug mode.");
+      const int book_depth = 10000;
+      const int order_count = 1000;
+#endif
+      const share_type ask_size = 10;
+
+      genesis_allocation allocation;
+      for( int i = 0; i <= book_depth; ++i )
+         allocation.emplace_back(public_key_type(fc::ecc::private_key::regenerate(fc::digest(i)).get_public_key()),
+                                 BTS_INITIAL_SUPPLY / (book_depth + 1));
+
+      fc::temp_directory data_dir(fc::current_path());
+      database db;
+      db.open(data_dir.path(), allocation);
+
+      asset_id_type other_id;
+      {
+         asset_create_operation creator;
+         creator.issuer = account_id_type(1);
+         creator.symbol = "OTHER";
+         creator.precision = 2;
+         creator.common_options.max_supply = BTS_MAX_SHARE_SUPPLY;
+         creator.common_options.core_exchange_rate = price({asset(1,1),asset(1)});
+         signed_transaction trx;
+         trx.operations.push_back(creator);
+         auto ptx = db.push_transaction(trx, ~0);
+         other_id = ptx.operation_results[0].get<object_id_type>();
+      }
+      const asset_object& other = other_id(db);
+
+      // Account 11 places the orders; the accounts after it each ask a little less OTHER per core than the one before
+      const account_id_type taker(11);
+      db._undo_db.disable();
+      for( int i = 0; i < book_depth; ++i )
+      {
+         account_id_type maker(12 + i);
+         db.create<limit_order_object>( [&]( limit_order_object& o ) {
+            o.seller = maker;
+            o.for_sale = ask_size;
+            o.set_sell_price( other.amount(ask_size) / asset(ask_size + i) );
+            o.expiration = fc::time_point_sec::maximum();
+         });
+      }
+      db.modify( other.dynamic_asset_data_id(db), [&]( asset_dynamic_data_object& d ) {
+         d.current_supply += ask_size * book_depth;
+      });
+      db._undo_db.enable();
+
+      auto place = [&]( const asset& amount_to_sell, const asset& min_to_receive ) {
+         limit_order_create_operation op;
+         op.seller = taker;
+         op.amount_to_sell = amount_to_sell;
+         op.min_to_receive = min_to_receive;
+         signed_transaction trx;
+         trx.operations.push_back(op);
+         db.push_transaction(trx, ~0);
+      };
+
+      // bids far below the best ask, which rest on the book
+      auto start_time = fc::time_point::now();
+      for( int i = 0; i < order_count; ++i )
+         place( asset(1), other.amount(ask_size * 1000 + i) );
+      auto resting = fc::time_point::now() - start_time;
+      db.clear_pending();
+
+      // bids at the best ask, each filling it exactly
+      start_time = fc::time_point::now();
+      for( int i = 0; i < order_count; ++i )
+         place( asset(ask_size + i), other.amount(1) );
+      auto crossing = fc::time_point::now() - start_time;
+
+      FC_ASSERT( db.get_index_type<limit_order_index>().indices().size() == size_t(book_depth - order_count) );
+      FC_ASSERT( db.get_balance( taker, other_id ) == other.amount(ask_size * order_count) );
+      ilog("Against a book ${d} deep: ${r} microseconds per resting order, ${c} per crossing order.",
+           ("d", book_depth)("r", resting.count() / order_count)("c", crossing.count() / order_count));
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
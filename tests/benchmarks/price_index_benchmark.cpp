@@ -0,0 +1,85 @@
+#include <bts/chain/limit_order_object.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include <random>
+
+using namespace bts::chain;
+
+namespace {
+
+/// The limit order index as it was sorted before orders stored their price's sort key
+typedef multi_index_container<
+   limit_order_object,
+   indexed_by<
+      hashed_unique< tag<by_id>,
+         member< object, object_id_type, &object::id > >,
+      ordered_unique< tag<by_price>,
+         composite_key< limit_order_object,
+            member< limit_order_object, price, &limit_order_object::sell_price>,
+            member< object, object_id_type, &object::id>
+         >,
+         composite_key_compare< std::greater<price>, std::less<object_id_type> >
+      >
+   >
+> price_sorted_index_type;
+
+/**
+ * Inserts the orders into an index, then takes the best order of the first market off the book until it is empty, as
+ * matching does, and reports the time each phase took.
+ */
+template<typename IndexType>
+void time_index( const string& name, const vector<limit_order_object>& orders, asset_id_type first_market )
+{
+   IndexType index;
+   auto start_time = fc::time_point::now();
+   for( const auto& order : orders )
+      index.insert( order );
+   auto inserted = fc::time_point::now() - start_time;
+
+   auto& price_idx = index.template get<by_price>();
+   size_t matched = 0;
+   start_time = fc::time_point::now();
+   for( auto itr = price_idx.lower_bound( price::max( first_market, asset_id_type() ) );
+        itr != price_idx.end() && itr->sell_price.base.asset_id == first_market; ++matched )
+      itr = price_idx.erase( itr );
+   auto match_time = fc::time_point::now() - start_time;
+   FC_ASSERT( matched > 0 && index.size() == orders.size() - matched );
+
+   ilog("${n}: inserted ${o} orders in ${i} milliseconds, took ${m} off the top of the book in ${t} milliseconds.",
+        ("n", name)("o", orders.size())("i", inserted.count() / 1000)("m", matched)("t", match_time.count() / 1000));
+}
+
+}
+
+BOOST_AUTO_TEST_CASE( price_index_bench )
+{
+   try {
+#ifdef NDEBUG
+      ilog("Running in release mode.");
+      const int order_count = 1000000;
+#else
+      ilog("Running in debug mode.");
+      const int order_count = 100000;
+#endif
+      const int market_count = 10;
+
+      // orders at random prices spread over a few markets, all selling against the core asset
+      std::mt19937_64 gen(0);
+      std::uniform_int_distribution<int64_t> amount( 1, BTS_MAX_SHARE_SUPPLY / 1000 );
+      vector<limit_order_object> orders( order_count );
+      for( int i = 0; i < order_count; ++i )
+      {
+         limit_order_object& order = orders[i];
+         order.id = limit_order_id_type(i);
+         order.for_sale = 1;
+         order.set_sell_price( asset( amount(gen), asset_id_type(1 + i % market_count) ) / asset( amount(gen) ) );
+      }
+
+      time_index<price_sorted_index_type>( "Sorted by price", orders, asset_id_type(1) );
+      time_index<limit_order_multi_index_type>( "Sorted by price key", orders, asset_id_type(1) );
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -0,0 +1,116 @@
+#include <bts/chain/database.hpp>
+#include <bts/chain/operations.hpp>
+#include <bts/chain/account_object.hpp>
+#include <bts/chain/proposal_object.hpp>
+
+#include <fc/crypto/digest.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace bts::chain;
+
+/**
+ * Approves a proposal one approver at a time, where the account it spends from needs every one of hundreds of accounts
+ * and keys to approve.
+ */
+BOOST_AUTO_TEST_CASE( proposal_approval_bench )
+{
+   try {
+#ifdef NDEBUG
+      ilog("Running in release mode.");
+      const int approver_count = 1000;
+#else
+      ilog("Running in debug mode.");
+      const int approver_count = 200;
+#endif
+
+      genesis_allocation allocation;
+      for( int i = 0; i <= approver_count; ++i )
+         allocation.emplace_back(public_key_type(fc::ecc::private_key::regenerate(fc::digest(i)).get_public_key()),
+                                 BTS_INITIAL_SUPPLY / (approver_count + 1));
+
+      fc::temp_directory data_dir(fc::current_path());
+      database db;
+      db.open(data_dir.path(), allocation);
+
+      // Account 11 is the multisig; half the approvers are the accounts after it, and half their keys
+      const account_id_type multisig(11);
+      vector<account_id_type> approving_accounts;
+      vector<key_id_type> approving_keys;
+      for( int i = 1; i <= approver_count; ++i )
+      {
+         if( i % 2 )
+            approving_accounts.push_back( account_id_type(11 + i) );
+         else
+            approving_keys.push_back( account_id_type(11 + i)(db).memo_key );
+      }
+      db._undo_db.disable();
+      db.modify( multisig(db), [&]( account_object& a ) {
+         a.active = authority();
+         for( const auto& id : approving_accounts )
+            a.active.add_authority( id, 1 );
+         for( const auto& id : approving_keys )
+            a.active.add_authority( id, 1 );
+         a.active.weight_threshold = approver_count;
+      });
+      db._undo_db.enable();
+
+      const uint32_t skip = ~0;
+      {
+         proposal_create_operation pop;
+         pop.proposed_ops.emplace_back(transfer_operation({asset(), multisig, account_id_type(), asset(500)}));
+         pop.fee_paying_account = account_id_type(11 + 1);
+         pop.expiration_time = db.head_block_time() + fc::days(1);
+         signed_transaction trx;
+         trx.operations.push_back(pop);
+         db.push_transaction(trx, skip);
+      }
+      proposal_id_type pid = db.get_index_type<proposal_index>().indices().begin()->id;
+
+      auto push_update = [&]( proposal_update_operation uop ) {
+         uop.proposal = pid;
+         uop.fee_paying_account = account_id_type(11 + 1);
+         signed_transaction trx;
+         trx.operations.push_back(uop);
+         db.push_transaction(trx, skip);
+      };
+
+      // A full walk of the authority, as every approval used to need, for comparison
+      fc::microseconds walk_time;
+      {
+         transaction_evaluation_state dry_run_eval(&db);
+         dry_run_eval._is_proposed_trx = true;
+         signed_transaction tmp;
+         dry_run_eval._trx = &tmp;
+         for( const auto& id : approving_keys )
+            tmp.signatures[id] = fc::ecc::compact_signature();
+         auto start_time = fc::time_point::now();
+         FC_ASSERT( !dry_run_eval.check_authority( multisig(db), authority::active ) );
+         walk_time = fc::time_point::now() - start_time;
+      }
+
+      auto start_time = fc::time_point::now();
+      for( const auto& id : approving_keys )
+      {
+         proposal_update_operation uop;
+         uop.key_approvals_to_add.insert(id);
+         push_update(uop);
+      }
+      for( const auto& id : approving_accounts )
+      {
+         FC_ASSERT( db.find_object(pid) != nullptr );
+         proposal_update_operation uop;
+         uop.active_approvals_to_add.insert(id);
+         push_update(uop);
+      }
+      auto elapsed = fc::time_point::now() - start_time;
+
+      // the last approval executed the proposal
+      FC_ASSERT( db.find_object(pid) == nullptr );
+      ilog("Approved a proposal by ${n} approvers in ${t} microseconds per approval; one authority walk takes ${w}.",
+           ("n", approver_count)("t", elapsed.count() / approver_count)("w", walk_time.count()));
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
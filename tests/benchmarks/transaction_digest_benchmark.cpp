@@ -0,0 +1,69 @@
+#include <bts/chain/config.hpp>
+#include <bts/chain/transaction.hpp>
+
+#include <fc/crypto/digest.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace bts::chain;
+
+/**
+ * Compares the hashing database::apply_transaction does per transaction: calling transaction::id() and digest()
+ * separately, as it used to, against a single transaction_digests.
+ */
+BOOST_AUTO_TEST_CASE( transaction_digest_bench )
+{
+   try {
+#ifdef NDEBUG
+      ilog("Running in release mode.");
+      const int trx_count = 200000;
+#else
+      ilog("Running in debug mode.");
+      const int trx_count = 10000;
+#endif
+      const int ops_per_trx = 4;
+
+      // Half of the transactions expire at an absolute time, the other half relative to a reference block
+      vector<signed_transaction> trxs( trx_count );
+      block_id_type ref_block = fc::ripemd160::hash( string("reference block") );
+      for( int i = 0; i < trx_count; ++i )
+      {
+         auto& trx = trxs[i];
+         if( i % 2 )
+            trx.set_expiration( fc::time_point_sec( BTS_GENESIS_TIMESTAMP + i ) );
+         else
+            trx.set_expiration( ref_block );
+         for( int o = 0; o < ops_per_trx; ++o )
+            trx.operations.push_back(transfer_operation({asset(), account_id_type(11 + i), account_id_type(12 + o),
+                                                         asset(1 + o)}));
+      }
+
+      uint64_t checksum = 0;
+      auto start_time = fc::time_point::now();
+      for( const auto& trx : trxs )
+      {
+         auto digest = trx.relative_expiration ? trx.digest( ref_block ) : trx.digest();
+         checksum += trx.id()._hash[0] + digest._hash[0];
+      }
+      auto separate = fc::time_point::now() - start_time;
+
+      uint64_t digests_checksum = 0;
+      start_time = fc::time_point::now();
+      for( const auto& trx : trxs )
+      {
+         const transaction_digests digests( trx );
+         auto digest = trx.relative_expiration ? digests.digest( ref_block ) : digests.digest();
+         digests_checksum += digests.id()._hash[0] + digest._hash[0];
+      }
+      auto combined = fc::time_point::now() - start_time;
+
+      BOOST_CHECK_EQUAL( checksum, digests_checksum );
+      ilog("Hashed ${n} transactions with separate id() and digest() calls in ${t} milliseconds.",
+           ("n", trx_count)("t", separate.count() / 1000));
+      ilog("Hashed ${n} transactions with transaction_digests in ${t} milliseconds.",
+           ("n", trx_count)("t", combined.count() / 1000));
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -0,0 +1,88 @@
+#include <bts/chain/database.hpp>
+#include <bts/chain/account_object.hpp>
+
+#include <fc/crypto/digest.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace bts::chain;
+
+BOOST_AUTO_TEST_CASE( undo_session_bench )
+{
+   try {
+#ifdef NDEBUG
+      ilog("Running in release mode.");
+      const int account_count = 100000;
+      const int blocks_to_apply = 10000;
+#else
+      ilog("Running in debug mode.");
+      const int account_count = 1000;
+      const int blocks_to_apply = 500;
+#endif
+      const int trx_per_block = 100;
+
+      genesis_allocation allocation;
+      for( int i = 0; i < account_count; ++i )
+         allocation.emplace_back(public_key_type(fc::ecc::private_key::regenerate(fc::digest(i)).get_public_key()),
+                                 BTS_INITIAL_SUPPLY / account_count);
+
+      fc::temp_directory data_dir(fc::current_path());
+      database db;
+      db.open(data_dir.path(), allocation);
+
+      // Each simulated transaction moves a share between two accounts, touching two balance objects
+      uint64_t trx_num = 0;
+      auto apply_trx = [&]() {
+         db.adjust_balance(account_id_type(11 + trx_num % account_count), asset(-1));
+         db.adjust_balance(account_id_type(11 + (trx_num * 7919 + 1) % account_count), asset(1));
+         ++trx_num;
+      };
+      // Mirrors apply_block: one session per block, one merged session per transaction
+      auto apply_block_with_undo = [&]() {
+         auto block_session = db._undo_db.start_undo_session();
+         for( int t = 0; t < trx_per_block; ++t )
+         {
+            auto trx_session = db._undo_db.start_undo_session();
+            apply_trx();
+            trx_session.merge();
+         }
+         block_session.commit();
+      };
+
+      db._undo_db.disable();
+      auto start_time = fc::time_point::now();
+      for( int b = 0; b < blocks_to_apply; ++b )
+         for( int t = 0; t < trx_per_block; ++t )
+            apply_trx();
+      auto untracked = fc::time_point::now() - start_time;
+      db._undo_db.enable();
+
+      // Fill the undo history so that the timed run reuses retired states and snapshots
+      for( size_t b = 0; b < db._undo_db.max_size(); ++b )
+         apply_block_with_undo();
+
+      start_time = fc::time_point::now();
+      for( int b = 0; b < blocks_to_apply; ++b )
+         apply_block_with_undo();
+      auto tracked = fc::time_point::now() - start_time;
+
+      const int64_t trx_count = int64_t(blocks_to_apply) * trx_per_block;
+      ilog("Applied ${n} transactions without undo tracking in ${t} milliseconds.",
+           ("n", trx_count)("t", untracked.count() / 1000));
+      ilog("Applied ${n} transactions with undo tracking in ${t} milliseconds.",
+           ("n", trx_count)("t", tracked.count() / 1000));
+      ilog("Undo tracking costs ${c} nanoseconds per transaction.",
+           ("c", (tracked.count() - untracked.count()) * 1000 / trx_count));
+
+      // Undoing the retained history must restore the balances exactly
+      auto balance = db.get_balance(account_id_type(11), asset_id_type());
+      auto block_session = db._undo_db.start_undo_session();
+      for( int t = 0; t < trx_per_block; ++t )
+         apply_trx();
+      block_session.undo();
+      BOOST_CHECK(db.get_balance(account_id_type(11), asset_id_type()) == balance);
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -0,0 +1,77 @@
+#include <bts/chain/database.hpp>
+#include <bts/chain/operations.hpp>
+#include <bts/chain/account_object.hpp>
+#include <bts/chain/delegate_object.hpp>
+
+#include <fc/crypto/digest.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace bts::chain;
+
+BOOST_AUTO_TEST_CASE( maintenance_vote_tally_bench )
+{
+   try {
+#ifdef NDEBUG
+      ilog("Running in release mode.");
+      const int account_count = 1000000;
+      const int transfers_per_interval = 10000;
+#else
+      ilog("Running in debug mode.");
+      const int account_count = 30000;
+      const int transfers_per_interval = 1000;
+#endif
+
+      genesis_allocation allocation;
+      for( int i = 0; i < account_count; ++i )
+         allocation.emplace_back(public_key_type(fc::ecc::private_key::regenerate(fc::digest(i)).get_public_key()),
+                                 BTS_INITIAL_SUPPLY / account_count);
+
+      fc::temp_directory data_dir(fc::current_path());
+      database db;
+      db.open(data_dir.path(), allocation);
+
+      // Every account votes for a couple of delegates, chosen so that each delegate gets a different share
+      vector<vote_id_type> delegate_votes;
+      for( delegate_id_type id : db.get_global_properties().active_delegates )
+         delegate_votes.push_back( id(db).vote_id );
+      db._undo_db.disable();
+      for( int i = 0; i < account_count; ++i )
+         db.modify( account_id_type(i + 11)(db), [&]( account_object& a ) {
+            a.votes.insert( delegate_votes[i % delegate_votes.size()] );
+            a.votes.insert( delegate_votes[(i * 7) % delegate_votes.size()] );
+            a.num_committee = 2;
+         });
+      db._undo_db.enable();
+
+      auto delegate_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("genesis")) );
+      auto generate_maintenance_block = [&]() -> fc::microseconds {
+         auto now = db.get_dynamic_global_properties().next_maintenance_time;
+         auto start_time = fc::time_point::now();
+         db.generate_block( now, db.get_scheduled_witness( now )->second, delegate_priv_key, ~0 );
+         return fc::time_point::now() - start_time;
+      };
+
+      // The first maintenance interval after opening tallies every account
+      auto elapsed = generate_maintenance_block();
+      ilog("Maintenance block with ${n} voting accounts (full tally) took ${t} milliseconds.",
+           ("n", account_count)("t", elapsed.count() / 1000));
+
+      for( int interval = 0; interval < 5; ++interval )
+      {
+         for( int i = 0; i < transfers_per_interval; ++i )
+         {
+            signed_transaction trx;
+            trx.operations.emplace_back(transfer_operation({asset(1), account_id_type(11 + (interval * transfers_per_interval + i) % account_count),
+                                                            account_id_type(11 + (i * 7919) % account_count), asset(1000), memo_data()}));
+            db.push_transaction(trx, ~0);
+         }
+         elapsed = generate_maintenance_block();
+         ilog("Maintenance block after ${c} transfers among ${n} voting accounts took ${t} milliseconds.",
+              ("c", transfers_per_interval)("n", account_count)("t", elapsed.count() / 1000));
+      }
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
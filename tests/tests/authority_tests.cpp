@@ -540,6 +540,224 @@ BOOST_FIXTURE_TEST_CASE( proposal_two_accounts, database_fixture )
    }
 } FC_LOG_AND_RETHROW() }
 
+/**
+ * The approvals of a proposal are counted toward its required authorities as they are added and removed, and counted
+ * again once a required authority changes.
+ */
+BOOST_FIXTURE_TEST_CASE( proposal_approval_tallies, database_fixture )
+{ try {
+   generate_block();
+
+   auto treasury_key = generate_private_key("treasury");
+   auto alice_key = generate_private_key("alice");
+   auto bob_key = generate_private_key("bob");
+   auto dave_key = generate_private_key("dave");
+   key_id_type treasury_key_id = register_key(treasury_key.get_public_key()).get_id();
+   key_id_type alice_key_id = register_key(alice_key.get_public_key()).get_id();
+   key_id_type bob_key_id = register_key(bob_key.get_public_key()).get_id();
+   key_id_type dave_key_id = register_key(dave_key.get_public_key()).get_id();
+   account_id_type treasury = create_account("treasury", treasury_key_id).id;
+   account_id_type alice = create_account("alice", alice_key_id).id;
+   account_id_type bob = create_account("bob", bob_key_id).id;
+   transfer(account_id_type()(db), treasury(db), asset(100000));
+   transfer(account_id_type()(db), alice(db), asset(100000));
+
+   // the treasury's active authority needs two of alice, bob and dave's key
+   {
+      account_update_operation op;
+      op.account = treasury;
+      op.active = authority(2, alice, 1, bob, 1, dave_key_id, 1);
+      trx.operations.push_back(op);
+      trx.sign(treasury_key_id, treasury_key);
+      db.push_transaction(trx);
+      trx.clear();
+   }
+
+   {
+      proposal_create_operation pop;
+      pop.proposed_ops.emplace_back(transfer_operation({asset(), treasury, alice, asset(500)}));
+      pop.fee_paying_account = alice;
+      pop.expiration_time = db.head_block_time() + fc::days(1);
+      trx.operations.push_back(pop);
+      trx.sign(alice_key_id, alice_key);
+      db.push_transaction(trx);
+      trx.clear();
+   }
+   const proposal_object& prop = *db.get_index_type<proposal_index>().indices().begin();
+   proposal_id_type pid = prop.id;
+   auto tally = [&]() -> approval_tally { return pid(db).active_approval_tallies.at(treasury); };
+   BOOST_CHECK_EQUAL(tally().approved_weight, 0);
+   BOOST_CHECK_EQUAL(tally().unapproved_account_weight, 2);
+   // alice and bob could also approve through their keys
+   BOOST_CHECK_EQUAL(tally().nested_members.size(), 2);
+   BOOST_CHECK_EQUAL(tally().nested_approvals, 0);
+
+   auto update = [&]( proposal_update_operation uop, key_id_type signer, const fc::ecc::private_key& key ) {
+      uop.proposal = pid;
+      uop.fee_paying_account = alice;
+      trx.operations.push_back(uop);
+      trx.sign(alice_key_id, alice_key);
+      if( signer != alice_key_id )
+         trx.sign(signer, key);
+      db.push_transaction(trx, database::skip_transaction_dupe_check);
+      trx.clear();
+   };
+
+   {
+      proposal_update_operation uop;
+      uop.active_approvals_to_add.insert(alice);
+      update(uop, alice_key_id, alice_key);
+   }
+   BOOST_CHECK_EQUAL(tally().approved_weight, 1);
+   BOOST_CHECK_EQUAL(tally().unapproved_account_weight, 1);
+   BOOST_CHECK(!prop.is_authorized_to_execute(&db));
+
+   // approving again counts nothing
+   {
+      proposal_update_operation uop;
+      uop.active_approvals_to_add.insert(alice);
+      update(uop, alice_key_id, alice_key);
+   }
+   BOOST_CHECK_EQUAL(tally().approved_weight, 1);
+
+   // an authority change of an account the treasury does not reach leaves the tally as it was counted
+   {
+      auto counted_revision = tally().authority_revision;
+      account_id_type carol = create_account("carol", dave_key_id).id;
+      transfer(account_id_type()(db), carol(db), asset(100000));
+      account_update_operation op;
+      op.account = carol;
+      op.active = authority(1, alice_key_id, 1);
+      trx.operations.push_back(op);
+      trx.sign(dave_key_id, dave_key);
+      db.push_transaction(trx);
+      trx.clear();
+      BOOST_REQUIRE(db.get_dynamic_global_properties().authority_revision != counted_revision);
+
+      proposal_update_operation uop;
+      uop.active_approvals_to_add.insert(alice);
+      update(uop, alice_key_id, alice_key);
+      BOOST_CHECK_EQUAL(tally().authority_revision, counted_revision);
+      BOOST_CHECK_EQUAL(tally().approved_weight, 1);
+   }
+
+   // dave's key and alice's approval would make two, but alice withdraws in the same update
+   {
+      proposal_update_operation uop;
+      uop.key_approvals_to_add.insert(dave_key_id);
+      uop.active_approvals_to_remove.insert(alice);
+      update(uop, dave_key_id, dave_key);
+   }
+   BOOST_REQUIRE(db.find_object(pid) != nullptr);
+   BOOST_CHECK_EQUAL(tally().approved_weight, 1);
+   BOOST_CHECK_EQUAL(tally().unapproved_account_weight, 2);
+   BOOST_CHECK(!prop.is_authorized_to_execute(&db));
+
+   // once the treasury needs only dave's key, the old tally is stale and the proposal can execute
+   {
+      account_update_operation op;
+      op.account = treasury;
+      op.active = authority(1, dave_key_id, 1);
+      trx.operations.push_back(op);
+      trx.sign(treasury_key_id, treasury_key);
+      db.push_transaction(trx);
+      trx.clear();
+   }
+   BOOST_CHECK(tally().authority_revision < treasury(db).authority_revision);
+   BOOST_CHECK(prop.is_authorized_to_execute(&db));
+
+   auto old_balance = get_balance(alice(db), asset_id_type()(db));
+   {
+      proposal_update_operation uop;
+      uop.active_approvals_to_add.insert(bob);
+      update(uop, bob_key_id, bob_key);
+   }
+   BOOST_CHECK(db.find_object(pid) == nullptr);
+   BOOST_CHECK_EQUAL(get_balance(alice(db), asset_id_type()(db)), old_balance + 500);
+} FC_LOG_AND_RETHROW() }
+
+/**
+ * An account with a zero threshold satisfies its authority without approving anything, so a proposal needing it may be
+ * executable although nothing nested in the required authority has approved.
+ */
+BOOST_FIXTURE_TEST_CASE( proposal_zero_threshold_nested_account, database_fixture )
+{ try {
+   generate_block();
+
+   auto treasury_key = generate_private_key("treasury");
+   auto alice_key = generate_private_key("alice");
+   auto bob_key = generate_private_key("bob");
+   auto dave_key = generate_private_key("dave");
+   key_id_type treasury_key_id = register_key(treasury_key.get_public_key()).get_id();
+   key_id_type alice_key_id = register_key(alice_key.get_public_key()).get_id();
+   key_id_type bob_key_id = register_key(bob_key.get_public_key()).get_id();
+   key_id_type dave_key_id = register_key(dave_key.get_public_key()).get_id();
+   account_id_type treasury = create_account("treasury", treasury_key_id).id;
+   account_id_type alice = create_account("alice", alice_key_id).id;
+   account_id_type bob = create_account("bob", bob_key_id).id;
+   transfer(account_id_type()(db), treasury(db), asset(100000));
+   transfer(account_id_type()(db), alice(db), asset(100000));
+   transfer(account_id_type()(db), bob(db), asset(100000));
+
+   // the treasury's active authority needs two of alice, bob and dave's key
+   {
+      account_update_operation op;
+      op.account = treasury;
+      op.active = authority(2, alice, 1, bob, 1, dave_key_id, 1);
+      trx.operations.push_back(op);
+      trx.sign(treasury_key_id, treasury_key);
+      db.push_transaction(trx);
+      trx.clear();
+   }
+
+   {
+      proposal_create_operation pop;
+      pop.proposed_ops.emplace_back(transfer_operation({asset(), treasury, alice, asset(500)}));
+      pop.fee_paying_account = alice;
+      pop.expiration_time = db.head_block_time() + fc::days(1);
+      trx.operations.push_back(pop);
+      trx.sign(alice_key_id, alice_key);
+      db.push_transaction(trx);
+      trx.clear();
+   }
+   const proposal_object& prop = *db.get_index_type<proposal_index>().indices().begin();
+   proposal_id_type pid = prop.id;
+
+   {
+      proposal_update_operation uop;
+      uop.proposal = pid;
+      uop.fee_paying_account = alice;
+      uop.key_approvals_to_add.insert(dave_key_id);
+      trx.operations.push_back(uop);
+      trx.sign(alice_key_id, alice_key);
+      trx.sign(dave_key_id, dave_key);
+      db.push_transaction(trx);
+      trx.clear();
+   }
+   BOOST_CHECK(!prop.is_authorized_to_execute(&db));
+   BOOST_CHECK(!pid(db).active_approval_tallies.at(treasury).nested_zero_threshold);
+
+   // bob's key is still in his authority, but he no longer needs it to approve
+   {
+      account_update_operation op;
+      op.account = bob;
+      op.active = authority(0, bob_key_id, 1);
+      trx.operations.push_back(op);
+      trx.sign(bob_key_id, bob_key);
+      db.push_transaction(trx);
+      trx.clear();
+   }
+
+   // the authority walk agrees that dave's key and bob make two
+   transaction_evaluation_state eval(&db);
+   eval._is_proposed_trx = true;
+   signed_transaction tmp;
+   tmp.signatures[dave_key_id] = fc::ecc::compact_signature();
+   eval._trx = &tmp;
+   BOOST_REQUIRE(eval.check_authority(treasury(db), authority::active));
+   BOOST_CHECK(prop.is_authorized_to_execute(&db));
+} FC_LOG_AND_RETHROW() }
+
 BOOST_FIXTURE_TEST_CASE( proposal_delete, database_fixture )
 { try {
    generate_block();
@@ -1005,4 +1223,72 @@ BOOST_FIXTURE_TEST_CASE( voting_account, database_fixture )
                          vikram_delegate) != db.get_global_properties().active_delegates.end());
 } FC_LOG_AND_RETHROW() }
 
+/**
+ * Authorities checked for one transaction are remembered for others signed by the same keys, until an account they
+ * depend on changes.
+ */
+BOOST_AUTO_TEST_CASE( cached_authorities )
+{ try {
+   fc::ecc::private_key parent_key = fc::ecc::private_key::regenerate(fc::digest("parent"));
+   key_id_type parent_key_id = register_key(parent_key.get_public_key()).get_id();
+   fc::ecc::private_key new_key = fc::ecc::private_key::regenerate(fc::digest("new"));
+   key_id_type new_key_id = register_key(new_key.get_public_key()).get_id();
+   const auto& core = asset_id_type()(db);
+
+   account_id_type parent_id = create_account("parent", parent_key_id).id;
+   {
+      auto make_child_op = make_account("child");
+      make_child_op.owner = authority(1, parent_id, 1);
+      make_child_op.active = authority(1, parent_id, 1);
+      trx.operations.push_back(make_child_op);
+      db.push_transaction(trx, ~0);
+      trx.operations.clear();
+   }
+   account_id_type child_id = get_account("child").id;
+   fund(child_id(db));
+   generate_block();
+   authority_cache& cache = db.get_authority_cache();
+
+   trx.operations.push_back(transfer_operation({asset(), child_id, account_id_type(), core.amount(500)}));
+   sign(trx, parent_key_id, parent_key);
+   db.push_transaction(trx, database::skip_transaction_dupe_check);
+   BOOST_CHECK(cache.is_approved(child_id, authority::active, {parent_key_id}));
+   BOOST_CHECK(!cache.is_approved(child_id, authority::active, {new_key_id}));
+   db.push_transaction(trx, database::skip_transaction_dupe_check);
+   BOOST_CHECK_EQUAL(cache.size(), 1);
+   trx.clear();
+
+   // the child's approval read the parent's authority, so replacing the parent's key forgets it
+   {
+      account_update_operation op;
+      op.account = parent_id;
+      op.owner = authority(1, new_key_id, 1);
+      op.active = authority(1, new_key_id, 1);
+      trx.operations.push_back(op);
+      sign(trx, parent_key_id, parent_key);
+      db.push_transaction(trx, database::skip_transaction_dupe_check);
+      trx.clear();
+   }
+   BOOST_CHECK(!cache.is_approved(child_id, authority::active, {parent_key_id}));
+
+   trx.operations.push_back(transfer_operation({asset(), child_id, account_id_type(), core.amount(500)}));
+   sign(trx, parent_key_id, parent_key);
+   BOOST_CHECK_THROW(db.push_transaction(trx, database::skip_transaction_dupe_check), fc::exception);
+   trx.signatures.clear();
+   sign(trx, new_key_id, new_key);
+   db.push_transaction(trx, database::skip_transaction_dupe_check);
+   BOOST_CHECK(cache.is_approved(child_id, authority::active, {new_key_id}));
+
+   // undoing the update restores the old key, and the approval made under the new one is dropped
+   db.clear_pending();
+   BOOST_CHECK(!cache.is_approved(child_id, authority::active, {new_key_id}));
+   trx.signatures.clear();
+   sign(trx, parent_key_id, parent_key);
+   db.push_transaction(trx, database::skip_transaction_dupe_check);
+   trx.clear();
+
+   generate_block();
+   BOOST_CHECK_EQUAL(cache.size(), 0);
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -47,6 +47,35 @@ BOOST_AUTO_TEST_CASE( price_test )
     BOOST_CHECK( ~price::max(0,1) <= ~price::min(0,1) );
 }
 
+BOOST_AUTO_TEST_CASE( sortable_price_test )
+{
+    // these differ by less than a double can tell apart at their magnitude, so only the exact comparison orders them
+    price close_low = asset(BTS_MAX_SHARE_SUPPLY - 1) / asset(BTS_MAX_SHARE_SUPPLY - 2, 1);
+    price close_high = asset(BTS_MAX_SHARE_SUPPLY - 2) / asset(BTS_MAX_SHARE_SUPPLY - 3, 1);
+    BOOST_CHECK_EQUAL( close_low.sort_key(), close_high.sort_key() );
+    BOOST_CHECK( close_low < close_high );
+    BOOST_CHECK( sortable_price(close_low) < sortable_price(close_high) );
+    BOOST_CHECK( !(sortable_price(close_high) < sortable_price(close_low)) );
+    BOOST_CHECK( !(sortable_price(close_low) < sortable_price(close_low)) );
+
+    vector<price> prices = { price::min(0,1), price::max(0,1), price::min(1,0), price::max(1,0), price::max(0,2),
+                             asset(1) / asset(3,1), asset(2) / asset(3,1), asset(4) / asset(6,1), asset(5) / asset(2,1),
+                             asset(BTS_MAX_SHARE_SUPPLY) / asset(BTS_MAX_SHARE_SUPPLY - 1, 1), close_low, close_high };
+    std::mt19937 gen(1);
+    for( int i = 0; i < 10; ++i )
+    {
+       std::shuffle( prices.begin(), prices.end(), gen );
+       vector<price> by_price = prices;
+       std::stable_sort( by_price.begin(), by_price.end() );
+       vector<price> by_key = prices;
+       std::stable_sort( by_key.begin(), by_key.end(), []( const price& a, const price& b ) {
+          return sortable_price(a) < sortable_price(b);
+       });
+       for( size_t j = 0; j < prices.size(); ++j )
+          BOOST_CHECK( by_key[j].base == by_price[j].base && by_key[j].quote == by_price[j].quote );
+    }
+}
+
 BOOST_AUTO_TEST_CASE( serialization_tests )
 {
    key_object k;
@@ -2,6 +2,8 @@
 #include <boost/test/unit_test.hpp>
 
 #include <bts/chain/database.hpp>
+#include <bts/chain/exceptions.hpp>
+#include <bts/chain/account_history_store.hpp>
 #include <bts/chain/operations.hpp>
 
 #include <bts/chain/account_object.hpp>
@@ -10,8 +12,12 @@
 #include <bts/chain/limit_order_object.hpp>
 #include <bts/chain/proposal_object.hpp>
 #include <bts/chain/short_order_object.hpp>
+#include <bts/chain/transaction_object.hpp>
 
 #include <fc/crypto/digest.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <boost/filesystem.hpp>
 
 #include "../common/database_fixture.hpp"
 
@@ -19,6 +25,194 @@ using namespace bts::chain;
 
 BOOST_AUTO_TEST_SUITE(block_tests)
 
+BOOST_AUTO_TEST_CASE( block_database_test )
+{
+   try {
+      fc::temp_directory data_dir;
+
+      block_database bdb;
+      bdb.open( data_dir.path() );
+      FC_ASSERT( bdb.is_open() );
+      BOOST_CHECK( !bdb.last().valid() );
+
+      signed_block b;
+      for( uint32_t i = 0; i < 5; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.witness = witness_id_type(i+1);
+         bdb.store( b.id(), b );
+
+         auto fetch = bdb.fetch_by_number( b.block_num() );
+         FC_ASSERT( fetch.valid() );
+         FC_ASSERT( fetch->witness == b.witness );
+         fetch = bdb.fetch_by_number( i+1 );
+         FC_ASSERT( fetch.valid() );
+         FC_ASSERT( fetch->witness == b.witness );
+         fetch = bdb.fetch_optional( b.id() );
+         FC_ASSERT( fetch.valid() );
+         FC_ASSERT( fetch->witness == b.witness );
+         FC_ASSERT( bdb.fetch_block_id( i+1 ) == b.id() );
+      }
+      BOOST_CHECK( !bdb.fetch_by_number( 6 ).valid() );
+
+      auto last_id = b.id();
+      bdb.remove( last_id );
+      BOOST_CHECK( !bdb.contains( last_id ) );
+      BOOST_CHECK_EQUAL( bdb.last()->block_num(), 4 );
+
+      // Replacing a block on a fork switch overwrites its index entry
+      b.witness = witness_id_type(100);
+      bdb.store( b.id(), b );
+      BOOST_CHECK( bdb.contains( b.id() ) );
+      BOOST_CHECK( bdb.fetch_by_number( 5 )->witness == witness_id_type(100) );
+      bdb.close();
+
+      bdb.open( data_dir.path() );
+      BOOST_CHECK_EQUAL( bdb.last()->block_num(), 5 );
+      BOOST_CHECK( bdb.fetch_block_id( 3 ) == bdb.fetch_by_number( 3 )->id() );
+      bdb.close();
+   } catch( fc::exception& e ) {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( block_database_torn_log )
+{
+   try {
+      fc::temp_directory data_dir;
+      auto blocks_file = (data_dir.path() / "blocks").string();
+
+      block_database bdb;
+      bdb.open( data_dir.path() );
+      vector<signed_block> blocks;
+      signed_block b;
+      uintmax_t size_after_3 = 0;
+      for( uint32_t i = 0; i < 5; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.witness = witness_id_type(i+1);
+         bdb.store( b.id(), b );
+         blocks.push_back( b );
+         if( i == 2 )
+         {
+            bdb.flush();
+            size_after_3 = boost::filesystem::file_size( blocks_file );
+         }
+      }
+      bdb.close();
+
+      // A crash tears the log part way through block 4, after the index entries for blocks 4 and 5 were written
+      boost::filesystem::resize_file( blocks_file, size_after_3 + 10 );
+
+      bdb.open( data_dir.path() );
+      BOOST_CHECK_EQUAL( bdb.last()->block_num(), 3 );
+      BOOST_CHECK( !bdb.fetch_by_number( 4 ).valid() );
+      BOOST_CHECK( !bdb.fetch_by_number( 5 ).valid() );
+
+      // A different block 4 is appended, where the lost entries would have pointed
+      signed_block replacement;
+      replacement.previous = blocks[2].id();
+      replacement.witness = witness_id_type(100);
+      bdb.store( replacement.id(), replacement );
+      BOOST_CHECK( bdb.contains( replacement.id() ) );
+      BOOST_CHECK( bdb.fetch_by_number( 4 )->witness == witness_id_type(100) );
+      BOOST_CHECK( !bdb.contains( blocks[3].id() ) );
+      BOOST_CHECK( !bdb.contains( blocks[4].id() ) );
+      BOOST_CHECK( !bdb.fetch_by_number( 5 ).valid() );
+      BOOST_CHECK( !bdb.fetch_optional( blocks[4].id() ).valid() );
+      BOOST_CHECK_EQUAL( bdb.last()->block_num(), 4 );
+      bdb.close();
+   } catch( fc::exception& e ) {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( account_history_store_test )
+{
+   try {
+      fc::temp_directory data_dir;
+      const account_id_type alice(1), bob(2);
+
+      account_history_store store;
+      store.open( data_dir.path() );
+      FC_ASSERT( store.is_open() );
+
+      auto make_ops = []( uint32_t block_num, const vector<vector<account_id_type>>& impacted )
+         -> vector<account_history_store::applied_operation>
+      {
+         vector<account_history_store::applied_operation> ops( impacted.size() );
+         for( size_t i = 0; i < impacted.size(); ++i )
+         {
+            ops[i].op.block_num = block_num;
+            ops[i].accounts.insert( impacted[i].begin(), impacted[i].end() );
+         }
+         return ops;
+      };
+
+      // each block: one operation for alice and bob, one for alice alone
+      for( uint32_t num = 1; num <= 5; ++num )
+      {
+         auto ops = make_ops( num, { {alice, bob}, {alice} } );
+         store.store_block( num, ops );
+         BOOST_CHECK( ops[1].op.id == operation_history_id_type( 2 * num ) );
+      }
+      BOOST_CHECK_EQUAL( store.get_account_history_size( alice ), 10 );
+      BOOST_CHECK_EQUAL( store.get_account_history_size( bob ), 5 );
+      BOOST_CHECK_EQUAL( store.get_next_sequence(), 11 );
+
+      auto hist = store.get_account_history( alice, 0, 100, 0 );
+      BOOST_REQUIRE_EQUAL( hist.size(), 10 );
+      for( size_t i = 0; i < hist.size(); ++i )
+         BOOST_CHECK_EQUAL( hist[i].id.instance(), 10 - i );
+
+      // seek into the middle of an account's history, and stop before a given operation
+      hist = store.get_account_history( alice, 0, 3, 5 );
+      BOOST_REQUIRE_EQUAL( hist.size(), 3 );
+      BOOST_CHECK_EQUAL( hist[0].id.instance(), 5 );
+      BOOST_CHECK_EQUAL( hist[2].id.instance(), 3 );
+      hist = store.get_account_history( bob, 0, 100, 6 );
+      BOOST_REQUIRE_EQUAL( hist.size(), 3 );
+      BOOST_CHECK_EQUAL( hist[0].id.instance(), 5 );
+      hist = store.get_account_history( alice, 7, 100, 0 );
+      BOOST_CHECK_EQUAL( hist.size(), 3 );
+      BOOST_CHECK( store.get_account_history( account_id_type(3), 0, 100, 0 ).empty() );
+
+      // re-applying block 4 on another fork discards what blocks 4 and 5 recorded
+      auto ops = make_ops( 4, { {bob} } );
+      store.store_block( 4, ops );
+      BOOST_CHECK( ops[0].op.id == operation_history_id_type( 7 ) );
+      BOOST_CHECK_EQUAL( store.get_account_history_size( alice ), 6 );
+      BOOST_CHECK_EQUAL( store.get_account_history_size( bob ), 4 );
+      hist = store.get_account_history( alice, 0, 100, 0 );
+      BOOST_REQUIRE_EQUAL( hist.size(), 6 );
+      BOOST_CHECK_EQUAL( hist[0].id.instance(), 6 );
+      BOOST_CHECK_EQUAL( store.get_account_history( bob, 0, 1, 0 )[0].id.instance(), 7 );
+
+      // history survives reopening the store
+      store.close();
+      store.open( data_dir.path() );
+      BOOST_CHECK_EQUAL( store.get_next_sequence(), 8 );
+      BOOST_CHECK_EQUAL( store.get_account_history_size( alice ), 6 );
+
+      // per-account pruning keeps only the most recent operations
+      store.set_max_ops_per_account( 2 );
+      ops = make_ops( 5, { {alice} } );
+      store.store_block( 5, ops );
+      BOOST_CHECK_EQUAL( store.get_account_history_size( alice ), 2 );
+      BOOST_CHECK_EQUAL( store.get_account_history_size( bob ), 4 );
+      hist = store.get_account_history( alice, 0, 100, 0 );
+      BOOST_REQUIRE_EQUAL( hist.size(), 2 );
+      BOOST_CHECK_EQUAL( hist[0].id.instance(), 8 );
+      BOOST_CHECK_EQUAL( hist[1].id.instance(), 6 );
+      store.close();
+   } catch( fc::exception& e ) {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( generate_empty_blocks )
 {
    try {
@@ -221,6 +415,138 @@ BOOST_AUTO_TEST_CASE( undo_pending )
    }
 }
 
+BOOST_AUTO_TEST_CASE( recover_from_checkpoint )
+{
+   try {
+      fc::time_point_sec now( BTS_GENESIS_TIMESTAMP );
+      fc::temp_directory data_dir;
+      auto delegate_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("genesis")) );
+      auto block_log = data_dir.path() / "database" / "block_log";
+      block_id_type crashed_head;
+      block_id_type checkpoint_head;
+      uintmax_t checkpoint_blocks_size = 0;
+      vector<signed_block> lost_blocks;
+      {
+         database db;
+         db.set_checkpoint_interval( 10 );
+         db.open(data_dir.path(), genesis_allocation() );
+
+         for( uint32_t i = 0; i < 25; ++i )
+         {
+            signed_transaction trx;
+            trx.set_expiration(db.head_block_time() + fc::minutes(1));
+            trx.operations.push_back(transfer_operation({asset(), account_id_type(), account_id_type(1 + i%5), asset(1000 + i)}));
+            db.push_transaction(trx, ~0);
+
+            now += db.block_interval();
+            auto b = db.generate_block( now, db.get_scheduled_witness( now )->second, delegate_priv_key, ~0 );
+            if( db.head_block_num() == 20 )
+            {
+               // the checkpoint just taken made the block log durable up to here
+               checkpoint_head = db.head_block_id();
+               checkpoint_blocks_size = boost::filesystem::file_size( (block_log / "blocks").string() );
+            }
+            else if( db.head_block_num() > 20 )
+               lost_blocks.push_back( b );
+         }
+
+         // Leave the database in the middle of applying a pending transaction, then "crash" by destroying it without
+         // closing; only the checkpoint taken at block 20 has been persisted.
+         signed_transaction trx;
+         trx.set_expiration(db.head_block_time() + fc::minutes(1));
+         trx.operations.push_back(transfer_operation({asset(), account_id_type(), account_id_type(1), asset(7777)}));
+         db.push_transaction(trx, ~0);
+         crashed_head = db.head_block_id();
+      }
+
+      // Destroying the database still wrote out the buffered blocks, which a kill would not have.  Tear the block log
+      // part way through the first block after the checkpoint, leaving the index entries for the lost blocks behind.
+      BOOST_REQUIRE( checkpoint_blocks_size > 0 );
+      boost::filesystem::resize_file( (block_log / "blocks").string(), checkpoint_blocks_size + 10 );
+
+      vector<int64_t> recovered_balances;
+      secret_hash_type recovered_random;
+      {
+         database db;
+         db.open(data_dir.path());
+         BOOST_CHECK_EQUAL( db.head_block_num(), 20 );
+         BOOST_CHECK( db.head_block_id() == checkpoint_head );
+         BOOST_CHECK( !db.fetch_block_by_number( 21 ).valid() );
+
+         // the node carries on from the checkpoint, receiving the lost blocks again
+         for( const auto& b : lost_blocks )
+            db.push_block( b, ~0 );
+         BOOST_CHECK_EQUAL( db.head_block_num(), 25 );
+         BOOST_CHECK( db.head_block_id() == crashed_head );
+         for( uint32_t i = 0; i < 6; ++i )
+            recovered_balances.push_back( db.get_balance(account_id_type(i), asset_id_type()).amount.value );
+         recovered_random = db.get_dynamic_global_properties().random;
+         db.close();
+      }
+      {
+         database db;
+         db.reindex(data_dir.path());
+         BOOST_CHECK_EQUAL( db.head_block_num(), 25 );
+         BOOST_CHECK( db.head_block_id() == crashed_head );
+         for( uint32_t i = 0; i < 6; ++i )
+            BOOST_CHECK_EQUAL( db.get_balance(account_id_type(i), asset_id_type()).amount.value, recovered_balances[i] );
+         BOOST_CHECK( db.get_dynamic_global_properties().random == recovered_random );
+      }
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( out_of_order_blocks )
+{
+   try {
+      fc::temp_directory data_dir1;
+      fc::temp_directory data_dir2;
+      fc::time_point_sec now( BTS_GENESIS_TIMESTAMP );
+
+      database db1;
+      db1.open( data_dir1.path(), genesis_allocation() );
+      database db2;
+      db2.open( data_dir2.path(), genesis_allocation() );
+
+      auto delegate_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("genesis")) );
+      vector<signed_block> blocks;
+      for( uint32_t i = 0; i < 6; ++i )
+      {
+         now += db1.block_interval();
+         blocks.push_back( db1.generate_block( now, db1.get_scheduled_witness( now )->second, delegate_priv_key ) );
+      }
+
+      db2.push_block( blocks[0] );
+      // A block which does not link is only held if its witness signed it
+      signed_block forged = blocks[5];
+      forged.timestamp += db1.block_interval();
+      BOOST_CHECK_THROW( db2.push_block( forged ), fc::assert_exception );
+
+      // Blocks arriving ahead of their parents are held rather than dropped
+      BOOST_CHECK_THROW( db2.push_block( blocks[5] ), unlinkable_block );
+      BOOST_CHECK_THROW( db2.push_block( blocks[3] ), unlinkable_block );
+      BOOST_CHECK_THROW( db2.push_block( blocks[2] ), unlinkable_block );
+      BOOST_CHECK_THROW( db2.push_block( blocks[4] ), unlinkable_block );
+      BOOST_CHECK_EQUAL( db2.head_block_num(), 1 );
+
+      // The missing parent links everything held behind it, and they extend the head without a fork switch
+      vector<uint32_t> applied;
+      auto connection = db2.applied_block.connect( [&]( const signed_block& b ) { applied.push_back( b.block_num() ); } );
+      BOOST_CHECK( !db2.push_block( blocks[1] ) );
+      connection.disconnect();
+      BOOST_CHECK( applied == vector<uint32_t>({ 2, 3, 4, 5, 6 }) );
+      BOOST_CHECK_EQUAL( db2.head_block_num(), 6 );
+      BOOST_CHECK_EQUAL( db2.head_block_id().str(), db1.head_block_id().str() );
+      for( const auto& b : blocks )
+         BOOST_CHECK( db2.fetch_block_by_id( b.id() ).valid() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( switch_forks_undo_create )
 {
    try {
@@ -261,6 +587,9 @@ BOOST_AUTO_TEST_CASE( switch_forks_undo_create )
       b =  db2.generate_block( now, db2.get_scheduled_witness( now )->second, delegate_priv_key );
       db1.push_block(b);
 
+      // The fork switch undid nathan's block, but the transaction creating him is pending again
+      BOOST_CHECK(nathan_id(db1).name == "nathan");
+      db1.clear_pending();
       BOOST_CHECK_THROW(nathan_id(db1), fc::exception);
 
       db2.push_transaction(trx);
@@ -278,6 +607,218 @@ BOOST_AUTO_TEST_CASE( switch_forks_undo_create )
    }
 }
 
+BOOST_AUTO_TEST_CASE( switch_forks_keeps_pending )
+{
+   try {
+      fc::temp_directory dir1,
+                         dir2;
+      auto delegate_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("genesis")) );
+      genesis_allocation allocation = {{public_key_type(delegate_priv_key.get_public_key()), 1}};
+      database db1,
+               db2;
+      db1.open(dir1.path(), allocation);
+      db2.open(dir2.path(), allocation);
+
+      fc::time_point_sec now( BTS_GENESIS_TIMESTAMP );
+      const account_id_type sender(11);
+      const key_id_type sender_key = sender(db1).active.auths.begin()->first;
+
+      now += db1.block_interval();
+      db2.push_block( db1.generate_block( now, db1.get_scheduled_witness( now )->second, delegate_priv_key ) );
+
+      vector<signed_transaction> transfers;
+      int64_t total_transferred = 0;
+      for( int i = 0; i < 300; ++i )
+      {
+         signed_transaction trx;
+         trx.set_expiration( db1.head_block_time() + fc::hours(1) );
+         trx.operations.push_back(transfer_operation({asset(), sender, account_id_type(1), asset(i + 1), memo_data()}));
+         trx.sign( sender_key, delegate_priv_key );
+         transfers.push_back( trx );
+         total_transferred += i + 1;
+      }
+      int64_t starting_balance = db1.get_balance( account_id_type(1), asset_id_type() ).amount.value;
+
+      // db1 includes the first 100 transfers in its block 2 and holds the rest as pending
+      auto fork_time = now + db1.block_interval();
+      for( int i = 0; i < 100; ++i )
+         db1.push_transaction( transfers[i] );
+      db1.generate_block( fork_time, db1.get_scheduled_witness( fork_time )->second, delegate_priv_key );
+      for( int i = 100; i < 300; ++i )
+         db1.push_transaction( transfers[i] );
+
+      // db2 builds a longer fork which includes only the first 10 transfers
+      vector<signed_block> fork;
+      for( int i = 0; i < 10; ++i )
+         db2.push_transaction( transfers[i] );
+      now = fork_time;
+      for( int i = 0; i < 3; ++i )
+      {
+         fork.push_back( db2.generate_block( now, db2.get_scheduled_witness( now )->second, delegate_priv_key ) );
+         now += db2.block_interval();
+      }
+
+      db1.push_block( fork[0] );
+      BOOST_CHECK( db1.push_block( fork[1] ) );
+      db1.push_block( fork[2] );
+      BOOST_CHECK_EQUAL( db1.head_block_id().str(), db2.head_block_id().str() );
+
+      // Every transfer is either on the new fork or pending again, and the next block picks up the pending ones
+      BOOST_CHECK_EQUAL( db1.get_balance( account_id_type(1), asset_id_type() ).amount.value,
+                         starting_balance + total_transferred );
+      auto b = db1.generate_block( now, db1.get_scheduled_witness( now )->second, delegate_priv_key );
+      BOOST_CHECK_EQUAL( b.transactions.size(), 290 );
+      BOOST_CHECK_EQUAL( db1.get_balance( account_id_type(1), asset_id_type() ).amount.value,
+                         starting_balance + total_transferred );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( unapplied_blocks_keep_pending )
+{
+   try {
+      fc::temp_directory dir1,
+                         dir2;
+      auto delegate_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("genesis")) );
+      genesis_allocation allocation = {{public_key_type(delegate_priv_key.get_public_key()), 1}};
+      database db1,
+               db2;
+      db1.open(dir1.path(), allocation);
+      db2.open(dir2.path(), allocation);
+
+      fc::time_point_sec now( BTS_GENESIS_TIMESTAMP );
+      vector<signed_block> blocks;
+      for( int i = 0; i < 3; ++i )
+      {
+         now += db1.block_interval();
+         blocks.push_back( db1.generate_block( now, db1.get_scheduled_witness( now )->second, delegate_priv_key ) );
+      }
+      db2.push_block( blocks[0] );
+
+      // An unsigned transfer is only pending because its signatures were skipped, so it would not survive being
+      // pushed again
+      int64_t starting_balance = db2.get_balance( account_id_type(1), asset_id_type() ).amount.value;
+      signed_transaction trx;
+      trx.set_expiration( db2.head_block_time() + fc::hours(1) );
+      trx.operations.push_back(transfer_operation({asset(), account_id_type(11), account_id_type(1), asset(100), memo_data()}));
+      db2.push_transaction( trx, database::skip_transaction_signatures | database::skip_authority_check );
+      BOOST_CHECK_EQUAL( db2.get_balance( account_id_type(1), asset_id_type() ).amount.value, starting_balance + 100 );
+
+      BOOST_CHECK( !db2.push_block( blocks[0] ) );
+      BOOST_CHECK_THROW( db2.push_block( blocks[2] ), unlinkable_block );
+      BOOST_CHECK_EQUAL( db2.head_block_num(), 1 );
+      BOOST_CHECK_EQUAL( db2.get_balance( account_id_type(1), asset_id_type() ).amount.value, starting_balance + 100 );
+
+      // a block which does change the head restores the pending transactions, which drops this one
+      db2.push_block( blocks[1] );
+      BOOST_CHECK_EQUAL( db2.head_block_num(), 3 );
+      BOOST_CHECK_EQUAL( db2.get_balance( account_id_type(1), asset_id_type() ).amount.value,
+                         db1.get_balance( account_id_type(1), asset_id_type() ).amount.value );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( large_block_merkle_root )
+{
+   try {
+      fc::temp_directory dir1,
+                         dir2;
+      auto delegate_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("genesis")) );
+      genesis_allocation allocation = {{public_key_type(delegate_priv_key.get_public_key()), 1}};
+      database db1,
+               db2;
+      db1.open(dir1.path(), allocation);
+      db2.open(dir2.path(), allocation);
+
+      const account_id_type sender(11);
+      const key_id_type sender_key = sender(db1).active.auths.begin()->first;
+      // enough transactions for the receiving node to hash them on its worker threads
+      for( int i = 0; i < 150; ++i )
+      {
+         signed_transaction trx;
+         trx.set_expiration( db1.head_block_time() + fc::hours(1) );
+         trx.operations.push_back(transfer_operation({asset(), sender, account_id_type(1), asset(i + 1)}));
+         trx.sign( sender_key, delegate_priv_key );
+         db1.push_transaction( trx );
+      }
+
+      fc::time_point_sec now( BTS_GENESIS_TIMESTAMP );
+      now += db1.block_interval();
+      auto b = db1.generate_block( now, db1.get_scheduled_witness( now )->second, delegate_priv_key );
+      BOOST_CHECK_EQUAL( b.transactions.size(), 150 );
+      BOOST_CHECK( b.transaction_merkle_root == b.calculate_merkle_root() );
+
+      // A block whose transactions don't match its merkle root is rejected
+      signed_block tampered = b;
+      tampered.transactions[100].operation_results.emplace_back( object_id_type() );
+      BOOST_CHECK_THROW( db2.push_block( tampered ), fc::exception );
+      BOOST_CHECK_EQUAL( db2.head_block_num(), 0 );
+
+      db2.push_block( b );
+      BOOST_CHECK_EQUAL( db2.head_block_id().str(), db1.head_block_id().str() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( push_block_does_not_yield )
+{
+   try {
+      fc::temp_directory dir1,
+                         dir2;
+      auto delegate_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("genesis")) );
+      genesis_allocation allocation = {{public_key_type(delegate_priv_key.get_public_key()), 1}};
+      database db1,
+               db2;
+      db1.open(dir1.path(), allocation);
+      db2.open(dir2.path(), allocation);
+
+      const account_id_type sender(11);
+      const key_id_type sender_key = sender(db1).active.auths.begin()->first;
+      auto transfer = [&]( int64_t amount ) -> signed_transaction {
+         signed_transaction trx;
+         trx.set_expiration( db1.head_block_time() + fc::hours(1) );
+         trx.operations.push_back(transfer_operation({asset(), sender, account_id_type(1), asset(amount)}));
+         trx.sign( sender_key, delegate_priv_key );
+         return trx;
+      };
+      // enough transactions for the receiving node to work on them on its worker threads
+      for( int i = 0; i < 150; ++i )
+         db1.push_transaction( transfer( i + 1 ) );
+      fc::time_point_sec now( BTS_GENESIS_TIMESTAMP );
+      now += db1.block_interval();
+      auto b = db1.generate_block( now, db1.get_scheduled_witness( now )->second, delegate_priv_key );
+      BOOST_CHECK_EQUAL( b.transactions.size(), 150 );
+
+      // Another task on this thread, such as a peer handing over a transaction, must not run until the push is done
+      signed_transaction extra = transfer( 1000 );
+      bool pushing = false;
+      bool interleaved = false;
+      auto other = fc::async( [&]() {
+         interleaved = pushing;
+         db2.push_transaction( extra );
+      }, "push during apply" );
+      pushing = true;
+      db2.push_block( b );
+      pushing = false;
+      other.wait();
+
+      BOOST_CHECK( !interleaved );
+      BOOST_CHECK_EQUAL( db2.head_block_id().str(), db1.head_block_id().str() );
+      now += db2.block_interval();
+      auto next = db2.generate_block( now, db2.get_scheduled_witness( now )->second, delegate_priv_key );
+      BOOST_CHECK_EQUAL( next.transactions.size(), 1 );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( duplicate_transactions )
 {
    try {
@@ -326,6 +867,56 @@ BOOST_AUTO_TEST_CASE( duplicate_transactions )
    }
 }
 
+BOOST_AUTO_TEST_CASE( expired_transaction_ids )
+{
+   try {
+      fc::time_point_sec now( BTS_GENESIS_TIMESTAMP );
+      fc::temp_directory data_dir;
+      database db;
+      db.open(data_dir.path());
+
+      auto delegate_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("genesis")) );
+      uint32_t skip = ~0 & ~database::skip_transaction_dupe_check;
+
+      fc::time_point_sec early_expiration = db.head_block_time() + fc::minutes(1);
+      signed_transaction early;
+      early.set_expiration(early_expiration);
+      early.operations.push_back(transfer_operation({asset(), account_id_type(), account_id_type(1), asset(500)}));
+      db.push_transaction(early, skip);
+
+      signed_transaction late;
+      late.set_expiration(db.head_block_time() + fc::hours(2));
+      late.operations.push_back(transfer_operation({asset(), account_id_type(), account_id_type(1), asset(700)}));
+      db.push_transaction(late, skip);
+
+      // pushed transactions can be served to peers while pending and after they are applied, until they expire
+      BOOST_CHECK(db.get_recent_transaction(early.id()).id() == early.id());
+      now += db.block_interval();
+      db.generate_block( now, db.get_scheduled_witness( now )->second, delegate_priv_key, skip );
+      BOOST_CHECK(db.get_recent_transaction(early.id()).id() == early.id());
+      BOOST_CHECK(db.get_recent_transaction(late.id()).id() == late.id());
+      BOOST_CHECK(db.is_known_transaction(early.id()));
+      BOOST_CHECK(db.is_known_transaction(late.id()));
+
+      // ids are kept for a forking window past their expiration
+      const auto& params = db.get_global_properties().parameters;
+      now = early_expiration + fc::seconds((params.maximum_undo_history - 1) * params.block_interval);
+      db.generate_block( now, db.get_scheduled_witness( now )->second, delegate_priv_key, skip );
+      BOOST_CHECK(db.is_known_transaction(early.id()));
+      BOOST_CHECK_THROW(db.get_recent_transaction(early.id()), fc::exception);
+      BOOST_CHECK(db.get_recent_transaction(late.id()).id() == late.id());
+      now += db.block_interval();
+      db.generate_block( now, db.get_scheduled_witness( now )->second, delegate_priv_key, skip );
+      BOOST_CHECK(!db.is_known_transaction(early.id()));
+      BOOST_CHECK(db.is_known_transaction(late.id()));
+
+      BOOST_CHECK_EQUAL(db.get_index_type<transaction_index>().indices().size(), 1);
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( tapos )
 {
    try {
@@ -424,6 +1015,13 @@ BOOST_FIXTURE_TEST_CASE( maintenance_interval, database_fixture )
                         maintenence_time.sec_since_epoch() + new_properties.parameters.maintenance_interval);
       maintenence_time = db.get_dynamic_global_properties().next_maintenance_time;
       BOOST_CHECK_GT(maintenence_time.sec_since_epoch(), db.head_block_time().sec_since_epoch());
+
+      // with the votes unchanged, the next maintenance leaves the genesis authorities, and their revision, alone
+      auto genesis_revision = account_id_type()(db).authority_revision;
+      generate_blocks(maintenence_time);
+      BOOST_CHECK_GT(db.get_dynamic_global_properties().next_maintenance_time.sec_since_epoch(),
+                     maintenence_time.sec_since_epoch());
+      BOOST_CHECK_EQUAL(account_id_type()(db).authority_revision, genesis_revision);
       db.close();
    } catch (fc::exception& e) {
       edump((e.to_detail_string()));
@@ -651,6 +1249,11 @@ BOOST_FIXTURE_TEST_CASE( force_settlement, database_fixture )
    BOOST_CHECK_EQUAL(call_id(db).debt.value, 3000);
    BOOST_CHECK(settle_id(db).owner == nathan_id);
 
+   //Nothing is settled before the settlement date
+   generate_block();
+   BOOST_CHECK(db.find(settle_id) != nullptr);
+   BOOST_CHECK_EQUAL(call_id(db).debt.value, 3000);
+
    generate_blocks(settle_id(db).settlement_date);
    BOOST_CHECK(db.find(settle_id) == nullptr);
    BOOST_CHECK_EQUAL(get_balance(nathan_id, asset_id_type()), 49);
@@ -695,6 +1298,86 @@ BOOST_FIXTURE_TEST_CASE( force_settlement, database_fixture )
    BOOST_CHECK(!db.get_index_type<call_order_index>().indices().empty());
 } FC_LOG_AND_RETHROW() }
 
+/**
+ * Maintenance resets the force settlement volume of the bitassets force settled during the interval, and leaves the
+ * rest alone.
+ */
+BOOST_FIXTURE_TEST_CASE( force_settled_volume_reset, database_fixture )
+{ try {
+   auto private_key = generate_private_key("genesis");
+   account_id_type nathan_id = create_account("nathan").get_id();
+   account_id_type shorter_id = create_account("shorter").get_id();
+   transfer(account_id_type()(db), nathan_id(db), asset(100000000));
+   transfer(account_id_type()(db), shorter_id(db), asset(100000000));
+   asset_id_type bit_usd = create_bitasset("BITUSD", account_id_type(1), 0).get_id();
+   asset_id_type bit_eur = create_bitasset("BITEUR", account_id_type(1), 0).get_id();
+   asset_id_type bit_cny = create_bitasset("BITCNY", account_id_type(1), 0).get_id();
+   generate_block();
+
+   create_short(shorter_id(db), asset(1000, bit_usd), asset(1000));
+   create_sell_order(nathan_id(db), asset(1000), asset(1000, bit_usd));
+   BOOST_CHECK_EQUAL(get_balance(nathan_id, bit_usd), 1000);
+
+   {
+      asset_update_bitasset_operation uop;
+      uop.issuer = bit_usd(db).issuer;
+      uop.asset_to_update = bit_usd;
+      uop.new_options = bit_usd(db).bitasset_data(db).options;
+      uop.new_options.force_settlement_delay_sec = 100;
+      trx.operations.push_back(uop);
+   } {
+      asset_update_feed_producers_operation uop;
+      uop.asset_to_update = bit_usd;
+      uop.issuer = bit_usd(db).issuer;
+      uop.new_feed_producers = {nathan_id};
+      trx.operations.push_back(uop);
+   } {
+      asset_publish_feed_operation pop;
+      pop.asset_id = bit_usd;
+      pop.publisher = nathan_id;
+      price_feed feed;
+      feed.settlement_price = price(asset(1),asset(1, bit_usd));
+      feed.call_limit = price::min(0, bit_usd);
+      feed.short_limit = price::min(bit_usd, 0);
+      pop.feed = feed;
+      trx.operations.push_back(pop);
+   }
+   trx.sign(key_id_type(),private_key);
+   db.push_transaction(trx);
+   trx.clear();
+
+   asset_settle_operation sop;
+   sop.account = nathan_id;
+   sop.amount = asset(50, bit_usd);
+   trx.operations.push_back(sop);
+   trx.sign(key_id_type(),private_key);
+   force_settlement_id_type settle_id = db.push_transaction(trx).operation_results.front().get<object_id_type>();
+   trx.clear();
+
+   generate_blocks(settle_id(db).settlement_date);
+   BOOST_CHECK(db.find(settle_id) == nullptr);
+   BOOST_CHECK_EQUAL(bit_usd(db).bitasset_data(db).force_settled_volume.value, 50);
+   auto next_maintenance_time = db.get_dynamic_global_properties().next_maintenance_time;
+   BOOST_REQUIRE(db.head_block_time() < next_maintenance_time);
+
+   // only the objects modified by the last block, which is the one that crosses the maintenance interval
+   vector<object_id_type> changed;
+   auto connection = db.changed_objects.connect( [&]( const vector<object_id_type>& ids ) { changed = ids; } );
+   generate_blocks(next_maintenance_time);
+   connection.disconnect();
+   BOOST_REQUIRE(db.get_dynamic_global_properties().next_maintenance_time > next_maintenance_time);
+
+   BOOST_CHECK_EQUAL(bit_usd(db).bitasset_data(db).force_settled_volume.value, 0);
+   BOOST_CHECK_EQUAL(bit_eur(db).bitasset_data(db).force_settled_volume.value, 0);
+   BOOST_CHECK_EQUAL(bit_cny(db).bitasset_data(db).force_settled_volume.value, 0);
+   auto was_changed = [&]( asset_id_type id ) -> bool {
+      return std::find(changed.begin(), changed.end(), object_id_type(*id(db).bitasset_data_id)) != changed.end();
+   };
+   BOOST_CHECK(was_changed(bit_usd));
+   BOOST_CHECK(!was_changed(bit_eur));
+   BOOST_CHECK(!was_changed(bit_cny));
+} FC_LOG_AND_RETHROW() }
+
 BOOST_FIXTURE_TEST_CASE( pop_block_twice, database_fixture )
 {
    try
@@ -1,6 +1,7 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <bts/app/api.hpp>
 #include <bts/chain/database.hpp>
 #include <bts/chain/operations.hpp>
 
@@ -8,6 +9,10 @@
 #include <bts/chain/key_object.hpp>
 
 #include <fc/crypto/digest.hpp>
+#include <fc/io/json.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <atomic>
 
 #include "../common/database_fixture.hpp"
 
@@ -38,3 +43,154 @@ BOOST_AUTO_TEST_CASE( undo_test )
       throw;
    }
 }
+
+BOOST_AUTO_TEST_CASE( snapshots_under_concurrent_api_load )
+{
+   try {
+      const int account_count = 100;
+      genesis_allocation allocation;
+      vector<fc::ecc::private_key> account_keys;
+      for( int i = 0; i < account_count; ++i )
+      {
+         account_keys.push_back(fc::ecc::private_key::regenerate(fc::digest(i)));
+         allocation.emplace_back(public_key_type(account_keys.back().get_public_key()), 1);
+      }
+      auto delegate_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("genesis")));
+
+      // Produce a chain of transfers between the genesis accounts
+      vector<signed_block> blocks;
+      {
+         fc::temp_directory data_dir;
+         database db;
+         db.open(data_dir.path(), allocation);
+         fc::time_point_sec now( BTS_GENESIS_TIMESTAMP );
+         for( int b = 0; b < 50; ++b )
+         {
+            for( int t = 0; t < 20; ++t )
+            {
+               int from = (b * 31 + t * 7) % account_count;
+               int to = (from + 1 + t) % account_count;
+               signed_transaction trx;
+               trx.set_expiration( db.head_block_time() + fc::hours(1) );
+               trx.operations.push_back(transfer_operation({asset(), account_id_type(11 + from), account_id_type(11 + to),
+                                                            asset(1 + b + t), memo_data()}));
+               trx.sign( account_id_type(11 + from)(db).active.auths.begin()->first, account_keys[from] );
+               db.push_transaction( trx );
+            }
+            now += db.block_interval();
+            blocks.push_back( db.generate_block( now, db.get_scheduled_witness( now )->second, delegate_priv_key ) );
+         }
+      }
+
+      fc::temp_directory data_dir;
+      database db;
+      db.open(data_dir.path(), allocation);
+      db.enable_snapshots( db.head_block_num() );
+      bts::app::database_api api( db );
+
+      vector<object_id_type> ids( 1, dynamic_global_property_id_type() );
+      const auto& balances = db.get_index_type<account_balance_index>().indices().get<by_balance>();
+      for( int i = 0; i < account_count; ++i )
+         ids.push_back( balances.find( boost::make_tuple( account_id_type(11 + i), asset_id_type() ) )->id );
+      share_type total_balance = 0;
+      for( size_t i = 1; i < ids.size(); ++i )
+         total_balance += db.get<account_balance_object>( ids[i] ).balance;
+
+      // Readers hammer the API while the blocks are pushed.  Each call must see the state as of a single block: the
+      // transfers never change the total, and the head block never moves backwards.
+      std::atomic<bool>     done( false );
+      std::atomic<uint32_t> inconsistent_reads( 0 );
+      std::atomic<uint32_t> reads( 0 );
+      vector<std::shared_ptr<fc::thread>> readers;
+      vector<fc::future<void>> readers_done;
+      for( int r = 0; r < 4; ++r )
+      {
+         readers.push_back( std::make_shared<fc::thread>( "api reader " + fc::to_string(r) ) );
+         readers_done.push_back( readers.back()->async( [&]() {
+            uint32_t last_head = 0;
+            while( !done )
+            {
+               auto objects = api.get_objects( ids );
+               auto head = objects[0].as<dynamic_global_property_object>().head_block_number;
+               share_type sum = 0;
+               for( size_t i = 1; i < objects.size(); ++i )
+                  sum += objects[i].as<account_balance_object>().balance;
+               if( sum != total_balance || head < last_head )
+                  ++inconsistent_reads;
+               last_head = head;
+               ++reads;
+            }
+         } ) );
+      }
+
+      for( const auto& b : blocks )
+         db.push_block( b );
+      done = true;
+      for( auto& f : readers_done )
+         f.wait();
+
+      BOOST_CHECK_EQUAL( inconsistent_reads.load(), 0 );
+      BOOST_CHECK( reads.load() > 0 );
+      auto snapshot = db.get_snapshot();
+      BOOST_CHECK_EQUAL( snapshot->revision(), db.head_block_num() );
+      for( const auto& id : ids )
+         BOOST_CHECK( fc::json::to_string( snapshot->get_object( id ).to_variant() ) ==
+                      fc::json::to_string( db.get_object( id ).to_variant() ) );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( snapshots_skip_fork_switch_states )
+{
+   try {
+      fc::temp_directory dir1,
+                         dir2;
+      auto delegate_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("genesis")));
+      database db1,
+               db2;
+      db1.open(dir1.path());
+      db2.open(dir2.path());
+      db1.enable_snapshots( db1.head_block_num() );
+
+      auto snapshot_head = [&]() -> block_id_type {
+         return db1.get_snapshot()->get( dynamic_global_property_id_type() ).head_block_id;
+      };
+
+      fc::time_point_sec now( BTS_GENESIS_TIMESTAMP );
+      now += db1.block_interval();
+      db2.push_block( db1.generate_block( now, db1.get_scheduled_witness( now )->second, delegate_priv_key ) );
+      BOOST_CHECK( snapshot_head() == db1.head_block_id() );
+
+      // db1 builds block 2 on its own, while db2 builds a longer fork
+      auto fork_time = now + db1.block_interval();
+      db1.generate_block( fork_time, db1.get_scheduled_witness( fork_time )->second, delegate_priv_key );
+      block_id_type old_head = db1.head_block_id();
+      vector<signed_block> fork;
+      now = fork_time;
+      for( int i = 0; i < 2; ++i )
+      {
+         fork.push_back( db2.generate_block( now, db2.get_scheduled_witness( now )->second, delegate_priv_key ) );
+         now += db2.block_interval();
+      }
+
+      // While db1 switches forks, readers still see the old head rather than the blocks being applied
+      vector<block_id_type> heads_seen;
+      auto connection = db1.applied_block.connect( [&]( const signed_block& ) { heads_seen.push_back( snapshot_head() ); } );
+      db1.push_block( fork[0] );
+      BOOST_CHECK( db1.push_block( fork[1] ) );
+      connection.disconnect();
+
+      BOOST_CHECK_EQUAL( heads_seen.size(), 2 );
+      for( const auto& head : heads_seen )
+         BOOST_CHECK( head == old_head );
+      BOOST_CHECK( snapshot_head() == fork[1].id() );
+      BOOST_CHECK_EQUAL( db1.get_snapshot()->revision(), db1.head_block_num() );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
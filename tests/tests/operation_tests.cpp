@@ -5,6 +5,7 @@
 
 #include <bts/chain/account_object.hpp>
 #include <bts/chain/asset_object.hpp>
+#include <bts/chain/bond_object.hpp>
 #include <bts/chain/database.hpp>
 #include <bts/chain/delegate_object.hpp>
 #include <bts/chain/key_object.hpp>
@@ -16,6 +17,8 @@
 
 #include <fc/crypto/digest.hpp>
 
+#include <random>
+
 #include "../common/database_fixture.hpp"
 
 using namespace bts::chain;
@@ -962,6 +965,32 @@ BOOST_AUTO_TEST_CASE( delegate_feeds )
    }
 }
 
+BOOST_AUTO_TEST_CASE( delegate_feeds_expire )
+{
+   try {
+      INVOKE( delegate_feeds );
+      generate_block();
+      const asset_bitasset_data_object& bitasset = get_asset("BITUSD").bitasset_data(db);
+      BOOST_REQUIRE( !bitasset.current_feed.call_limit.is_null() );
+      // the feeds were published together, so they all expire at once
+      auto expiration = bitasset.feed_expiration_time();
+
+      now = expiration - 2 * db.block_interval();
+      generate_block();
+      BOOST_CHECK( !bitasset.current_feed.call_limit.is_null() );
+
+      // the first block after the expiration falls a slot past it
+      now = expiration;
+      generate_block();
+      BOOST_CHECK( db.head_block_time() > expiration );
+      BOOST_CHECK( bitasset.current_feed.call_limit.is_null() );
+      BOOST_CHECK( bitasset.feed_expiration_time() > db.head_block_time() );
+   } catch (const fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 /**
  *  Assume there exists an offer to buy BITUSD
  *  Create a short that exactly matches that offer at a price 2:1
@@ -1355,6 +1384,91 @@ BOOST_AUTO_TEST_CASE( limit_order_matching_mix_of_shorts_and_limits )
   throw;
 } }
 
+BOOST_AUTO_TEST_CASE( market_depth_levels )
+{ try {
+   db.enable_market_depth();
+   const market_depth& depth = *db.get_market_depth();
+
+   const asset_object& bitusd      = create_bitasset( "BITUSD" );
+   const asset_object& bts         = get_asset( BTS_SYMBOL );
+   const account_object& shorter1  = create_account( "shorter1" );
+   const account_object& shorter2  = create_account( "shorter2" );
+   const account_object& buyer1    = create_account( "buyer1" );
+   const account_object& buyer2    = create_account( "buyer2" );
+
+   transfer( genesis_account(db), shorter1, bts.amount( 10000 ) );
+   transfer( genesis_account(db), shorter2, bts.amount( 10000 ) );
+   transfer( genesis_account(db), buyer1, bts.amount( 10000 ) );
+   transfer( genesis_account(db), buyer2, bts.amount( 10000 ) );
+
+   // every book must match one aggregated from scratch
+   auto check_against_rebuild = [&]() {
+      market_depth rebuilt;
+      rebuilt.enable( db );
+      for( auto type : { limit_depth, short_depth, call_depth } )
+         for( auto market : { std::make_pair( bitusd.get_id(), bts.get_id() ), std::make_pair( bts.get_id(), bitusd.get_id() ) } )
+         {
+            auto expected = rebuilt.get_levels( type, market.first, market.second, 100 );
+            auto actual = depth.get_levels( type, market.first, market.second, 100 );
+            BOOST_REQUIRE_EQUAL( actual.size(), expected.size() );
+            for( size_t i = 0; i < actual.size(); ++i )
+            {
+               BOOST_CHECK( actual[i].sell_price == expected[i].sell_price );
+               BOOST_CHECK_EQUAL( actual[i].for_sale.value, expected[i].for_sale.value );
+               BOOST_CHECK_EQUAL( actual[i].order_count, expected[i].order_count );
+            }
+         }
+   };
+
+   // create some BitUSD, and with it a call order
+   BOOST_REQUIRE( create_sell_order( buyer1, bts.amount(1000), bitusd.amount(1000) ) );
+   BOOST_REQUIRE( !create_short( shorter1, bitusd.amount(1000), bts.amount(1000) )   );
+   BOOST_CHECK_EQUAL( depth.get_levels( call_depth, bts.get_id(), bitusd.get_id(), 10 ).size(), 1 );
+
+   BOOST_REQUIRE( create_sell_order( buyer1, bitusd.amount(100), bts.amount(150) ) );
+   BOOST_REQUIRE( create_sell_order( buyer1, bitusd.amount(200), bts.amount(300) ) );
+   const limit_order_object* worst_ask = create_sell_order( buyer1, bitusd.amount(100), bts.amount(225) );
+   BOOST_REQUIRE( worst_ask );
+   BOOST_REQUIRE( create_short( shorter1, bitusd.amount(100), bts.amount(125) ) );
+   BOOST_REQUIRE( create_short( shorter2, bitusd.amount(100), bts.amount(125) ) );
+
+   // orders at the same price share a level, and the best price comes first
+   auto asks = depth.get_levels( limit_depth, bitusd.get_id(), bts.get_id(), 10 );
+   BOOST_REQUIRE_EQUAL( asks.size(), 2 );
+   BOOST_CHECK( asks[0].sell_price == bitusd.amount(100) / bts.amount(150) );
+   BOOST_CHECK_EQUAL( asks[0].for_sale.value, 300 );
+   BOOST_CHECK_EQUAL( asks[0].order_count, 2 );
+   BOOST_CHECK( asks[1].sell_price == bitusd.amount(100) / bts.amount(225) );
+   BOOST_CHECK_EQUAL( asks[1].for_sale.value, 100 );
+   BOOST_CHECK_EQUAL( depth.get_levels( limit_depth, bitusd.get_id(), bts.get_id(), 1 ).size(), 1 );
+   auto shorts = depth.get_levels( short_depth, bitusd.get_id(), bts.get_id(), 10 );
+   BOOST_REQUIRE_EQUAL( shorts.size(), 1 );
+   BOOST_CHECK_EQUAL( shorts[0].order_count, 2 );
+   check_against_rebuild();
+
+   // partially fill the book, and empty the worst level
+   create_sell_order( buyer2, bts.amount(200), bitusd.amount(100) );
+   auto worst_price = worst_ask->sell_price;
+   cancel_limit_order( *worst_ask );
+   check_against_rebuild();
+   auto changed = depth.get_changed_levels();
+   auto emptied = std::find_if( changed.begin(), changed.end(), [&]( const price_level& l ) {
+      return l.order_type == limit_depth && l.sell_price.base.asset_id == bitusd.get_id() && l.sell_price == worst_price;
+   });
+   BOOST_REQUIRE( emptied != changed.end() );
+   BOOST_CHECK_EQUAL( emptied->order_count, 0 );
+
+   // changes are reported per block, and undoing a block restores its levels
+   generate_block();
+   BOOST_CHECK( depth.get_changed_levels().empty() );
+   check_against_rebuild();
+   db.pop_block();
+   check_against_rebuild();
+} catch ( const fc::exception& e ) {
+   elog( "${e}", ("e", e.to_detail_string() ) );
+   throw;
+} }
+
 BOOST_AUTO_TEST_CASE( big_short )
 {
    try {
@@ -2089,6 +2203,224 @@ BOOST_AUTO_TEST_CASE( margin_call_black_swan )
       throw;
    }
 }
+/**
+ *  A black swan cancels every short and every limit order selling the bitasset, but leaves bids for it alone.
+ */
+BOOST_AUTO_TEST_CASE( black_swan_cancels_orders )
+{ try {
+      const asset_object& bitusd      = create_bitasset( "BITUSD" );
+      const asset_object& bts         = get_asset( BTS_SYMBOL );
+
+      db.modify( bitusd.bitasset_data(db), [&]( asset_bitasset_data_object& usd ){
+                 usd.current_feed.call_limit = bts.amount(30) / bitusd.amount(1);
+                 });
+
+      const account_object& shorter1  = create_account( "shorter1" );
+      const account_object& shorter2  = create_account( "shorter2" );
+      const account_object& buyer1    = create_account( "buyer1" );
+      const account_object& buyer2    = create_account( "buyer2" );
+
+      transfer( genesis_account(db), shorter1, asset( 10000 ) );
+      transfer( genesis_account(db), shorter2, asset( 10000 ) );
+      transfer( genesis_account(db), buyer1, asset( 10000 ) );
+      transfer( genesis_account(db), buyer2, asset( 10000 ) );
+
+      BOOST_REQUIRE( create_sell_order( buyer1, asset(1000), bitusd.amount(1000) ) );
+      BOOST_REQUIRE( !create_short( shorter1, bitusd.amount(1000), asset(1000) )   );
+
+      transfer( buyer1, buyer2, bitusd.amount(100) );
+      BOOST_REQUIRE( create_sell_order( buyer2, bitusd.amount(100), bts.amount(100000) ) );
+      BOOST_REQUIRE( create_short( shorter2, bitusd.amount(10), asset(5000) ) );
+      const limit_order_object* bid = create_sell_order( buyer2, bts.amount(1), bitusd.amount(100) );
+      BOOST_REQUIRE( bid );
+      auto bid_id = bid->id;
+
+      // the same price as in margin_call_black_swan
+      BOOST_REQUIRE( !create_sell_order( buyer1, bitusd.amount(890), bts.amount(4495) ) );
+
+      BOOST_CHECK_EQUAL( db.get_index_type<limit_order_index>().indices().size(), 1 );
+      BOOST_CHECK( db.find_object( bid_id ) );
+      BOOST_CHECK( db.get_index_type<short_order_index>().indices().empty() );
+      BOOST_CHECK( db.get_index_type<call_order_index>().indices().empty() );
+      BOOST_CHECK_EQUAL( get_balance( shorter2, bts ), 10000 );
+      BOOST_CHECK_EQUAL( get_balance( buyer1, bitusd ), 0 );
+      BOOST_CHECK_EQUAL( get_balance( buyer2, bitusd ), 0 );
+   } catch( const fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+/**
+ *  A black swan converts the collateral of every bond backed by the bitasset and refunds every bond offer holding it.
+ */
+BOOST_AUTO_TEST_CASE( black_swan_settles_bonds )
+{ try {
+      const asset_object& bitusd      = create_bitasset( "BITUSD" );
+      const asset_object& bts         = get_asset( BTS_SYMBOL );
+
+      db.modify( bitusd.bitasset_data(db), [&]( asset_bitasset_data_object& usd ){
+                 usd.current_feed.call_limit = bts.amount(30) / bitusd.amount(1);
+                 });
+
+      const account_object& shorter1  = create_account( "shorter1" );
+      const account_object& buyer1    = create_account( "buyer1" );
+      const account_object& buyer2    = create_account( "buyer2" );
+
+      transfer( genesis_account(db), shorter1, asset( 10000 ) );
+      transfer( genesis_account(db), buyer1, asset( 10000 ) );
+
+      BOOST_REQUIRE( create_sell_order( buyer1, asset(1000), bitusd.amount(1000) ) );
+      BOOST_REQUIRE( !create_short( shorter1, bitusd.amount(1000), asset(1000) )   );
+
+      // buyer1 pledges bitusd as the collateral of three bonds, and buyer2 offers bitusd in two bond offers
+      vector<bond_id_type> bonds;
+      for( int i = 0; i < 3; ++i )
+      {
+         db.adjust_balance( buyer1, -bitusd.amount(100) );
+         bonds.push_back( db.create<bond_object>( [&]( bond_object& b ) {
+            b.borrower = buyer1.get_id();
+            b.lender = buyer2.get_id();
+            b.borrowed = bts.amount(10);
+            b.collateral = bitusd.amount(100);
+         }).id );
+      }
+      transfer( buyer1, buyer2, bitusd.amount(100) );
+      for( int i = 0; i < 2; ++i )
+      {
+         db.adjust_balance( buyer2, -bitusd.amount(50) );
+         db.create<bond_offer_object>( [&]( bond_offer_object& o ) {
+            o.offered_by_account = buyer2.get_id();
+            o.amount = bitusd.amount(50);
+         });
+      }
+      BOOST_REQUIRE_EQUAL( get_balance( buyer2, bitusd ), 0 );
+
+      BOOST_REQUIRE( !create_sell_order( buyer1, bitusd.amount(590), bts.amount(2980) ) );
+
+      BOOST_CHECK( db.get_index_type<call_order_index>().indices().empty() );
+      BOOST_CHECK( db.get_index_type<bond_offer_index>().indices().empty() );
+      const bond_object& first_bond = bonds.front()(db);
+      BOOST_CHECK( first_bond.collateral.asset_id == bts.id );
+      BOOST_CHECK_GT( first_bond.collateral.amount.value, 0 );
+      for( const auto& bond_id : bonds )
+         BOOST_CHECK( bond_id(db).collateral == first_bond.collateral );
+      // both offers, 100 bitusd in all as is each bond, were refunded and then settled with the other balances
+      BOOST_CHECK_EQUAL( get_balance( buyer2, bitusd ), 0 );
+      BOOST_CHECK_EQUAL( get_balance( buyer2, bts ), first_bond.collateral.amount.value );
+   } catch( const fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+/// The n'th order (modulo their count) placed by seller, in book order
+template<typename PriceIndex>
+static const typename PriceIndex::value_type* nth_order_of( const PriceIndex& price_index, account_id_type seller, uint32_t n )
+{
+   vector<const typename PriceIndex::value_type*> orders;
+   for( const auto& o : price_index )
+      if( o.seller == seller )
+         orders.push_back( &o );
+   return orders.empty() ? nullptr : orders[n % orders.size()];
+}
+
+/**
+ *  Drives the same random order flow through a second chain which always scans the order books for margin calls,
+ *  and requires every order, call and balance to stay identical to the chain using the call check cache.
+ */
+BOOST_AUTO_TEST_CASE( margin_call_cache_differential )
+{ try {
+   database_fixture reference;
+   reference.db._disable_call_check_cache = true;
+   vector<database_fixture*> chains = { this, &reference };
+
+   vector<account_id_type> traders;
+   asset_id_type usd_id;
+   for( database_fixture* f : chains )
+   {
+      const asset_object& bitusd = f->create_bitasset( "BITUSD" );
+      usd_id = bitusd.id;
+      f->db.modify( bitusd.bitasset_data(f->db), [&]( asset_bitasset_data_object& usd ){
+         usd.current_feed.call_limit = asset(3) / bitusd.amount(1);
+      });
+      traders.clear();
+      for( int i = 0; i < 6; ++i )
+      {
+         const account_object& trader = f->create_account( "trader" + fc::to_string(i) );
+         f->transfer( f->genesis_account(f->db), trader, asset(1000000) );
+         traders.push_back( trader.id );
+      }
+   }
+
+   auto market_state = [&]( const database_fixture& f ) -> vector<char> {
+      vector<char> state;
+      auto append = [&]( const vector<char>& data ) { state.insert( state.end(), data.begin(), data.end() ); };
+      for( const auto& o : f.db.get_index_type<limit_order_index>().indices().get<by_price>() ) append( o.pack() );
+      for( const auto& o : f.db.get_index_type<short_order_index>().indices().get<by_price>() ) append( o.pack() );
+      for( const auto& o : f.db.get_index_type<call_order_index>().indices().get<by_price>() ) append( o.pack() );
+      for( auto t : traders )
+      {
+         append( fc::raw::pack( f.db.get_balance( t, asset_id_type() ) ) );
+         append( fc::raw::pack( f.db.get_balance( t, usd_id ) ) );
+      }
+      return state;
+   };
+
+   std::mt19937 rng( 1776 );
+   uint32_t margin_calls = 0;
+   for( int step = 0; step < 3000; ++step )
+   {
+      const uint32_t action = rng() % 8;
+      const account_id_type trader = traders[rng() % traders.size()];
+      const int64_t a = 1 + rng() % 2000;
+      const int64_t b = 1 + rng() % 2000;
+      const uint32_t n = rng();
+
+      vector<bool> failed;
+      auto calls_before = reference.db.get_index_type<call_order_index>().indices().size();
+      for( database_fixture* f : chains )
+      {
+         try {
+            switch( action )
+            {
+               case 0: // bid for USD
+               case 1:
+                  f->create_sell_order( trader, asset(a), asset(b, usd_id) );
+                  break;
+               case 2: // ask for BTS, which may fill margin calls
+               case 3:
+                  f->create_sell_order( trader, asset(a, usd_id), asset(b) );
+                  break;
+               case 4:
+                  f->create_short( trader, asset(a, usd_id), asset(b * 3) );
+                  break;
+               case 5:
+                  if( auto order = nth_order_of( f->db.get_index_type<limit_order_index>().indices().get<by_price>(), trader, n ) )
+                     f->cancel_limit_order( *order );
+                  break;
+               case 6:
+                  if( auto order = nth_order_of( f->db.get_index_type<short_order_index>().indices().get<by_price>(), trader, n ) )
+                     f->cancel_short_order( *order );
+                  break;
+               case 7: // applying a block undoes and reapplies the pending transactions
+                  f->generate_block();
+                  break;
+            }
+            failed.push_back( false );
+         } catch( const fc::exception& ) {
+            f->trx.clear();
+            failed.push_back( true );
+         }
+      }
+      BOOST_REQUIRE( failed[0] == failed[1] );
+      BOOST_REQUIRE( market_state( *this ) == market_state( reference ) );
+      if( reference.db.get_index_type<call_order_index>().indices().size() < calls_before )
+         ++margin_calls;
+   }
+   ilog( "Covered ${n} call orders", ("n", margin_calls) );
+} FC_LOG_AND_RETHROW() }
+
 /**
  *  This test sets up a far more complex blackswan scenerio where the
  *  BitUSD exists in the following places: